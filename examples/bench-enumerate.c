@@ -0,0 +1,75 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <tempered.h>
+
+/**
+This example measures how long it takes to enumerate the devices. The number of
+rounds can be given as an argument.
+
+To measure how enumeration scales without any devices attached, it can be run
+against a synthetic sysfs tree, which should hold a class/hidraw/hidrawN/device
+directory with a uevent file (containing HID_ID and HID_PHYS lines) for each
+fake device, by setting TEMPERED_TRANSPORT to e.g. "hidraw:sysfs=/tmp/fake".
+*/
+
+/** Get the current CLOCK_MONOTONIC time in milliseconds. */
+double now_ms( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+int main( int argc, char *argv[] )
+{
+	int rounds = ( argc > 1 ? atoi( argv[1] ) : 10 );
+	if ( rounds <= 0 )
+	{
+		fprintf( stderr, "Usage: %s [rounds]\n", argv[0] );
+		return 1;
+	}
+	
+	char *error = NULL;
+	if ( !tempered_init( &error ) )
+	{
+		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	
+	int count = 0;
+	double start = now_ms();
+	int i;
+	for ( i = 0; i < rounds; i++ )
+	{
+		struct tempered_device_list *list = tempered_enumerate( &error );
+		if ( list == NULL && error != NULL )
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+			tempered_exit( NULL );
+			return 1;
+		}
+		count = 0;
+		struct tempered_device_list *dev;
+		for ( dev = list ; dev != NULL ; dev = dev->next )
+		{
+			count++;
+		}
+		tempered_free_device_list( list );
+	}
+	double elapsed = now_ms() - start;
+	printf(
+		"%d rounds: %.3f ms/round, %d devices found\n",
+		rounds, elapsed / rounds, count
+	);
+	
+	if ( !tempered_exit( &error ) )
+	{
+		fprintf( stderr, "Failed to shut down libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	return 0;
+}
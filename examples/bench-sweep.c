@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <tempered.h>
+
+/**
+This example measures how long it takes to read all the attached devices at
+once with a device set, first using epoll and then using io_uring, so that the
+two can be compared. The number of sweeps can be given as an argument.
+
+Note that io_uring is only used with the hidraw transport; with the others the
+device set falls back to epoll, so both results will be about the same.
+*/
+
+/** Get the current CLOCK_MONOTONIC time in milliseconds. */
+double now_ms( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+/** Read all the given devices the given number of times, and print how long
+ * that took on average.
+ */
+void bench_devices(
+	tempered_device **devices, int count, int sweeps, bool use_uring
+) {
+	char *error = NULL;
+	tempered_device_set *set = tempered_device_set_create( &error );
+	if ( set == NULL )
+	{
+		fprintf( stderr, "Failed to create the device set: %s\n", error );
+		free( error );
+		return;
+	}
+	if ( tempered_device_set_use_uring( set, use_uring ) != use_uring )
+	{
+		printf( "io_uring: not supported by this build.\n" );
+		tempered_device_set_destroy( set );
+		return;
+	}
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		if ( !tempered_device_set_add( set, devices[i] ) )
+		{
+			fprintf(
+				stderr, "%s: Failed to add to the set: %s\n",
+				tempered_get_device_path( devices[i] ),
+				tempered_error( devices[i] )
+			);
+		}
+	}
+	// The first sweep sets everything up, so leave it out of the timing.
+	tempered_device_set_read_all( set, -1 );
+	long succeeded = 0;
+	double start = now_ms();
+	for ( i = 0; i < sweeps; i++ )
+	{
+		succeeded += tempered_device_set_read_all( set, -1 );
+	}
+	double elapsed = now_ms() - start;
+	printf(
+		"%-8s %d devices, %d sweeps: %.3f ms/sweep, %.1f us/device, "
+			"%ld of %ld reads succeeded\n",
+		use_uring ? "io_uring" : "epoll", count, sweeps,
+		elapsed / sweeps, elapsed * 1000 / sweeps / count,
+		succeeded, (long) sweeps * count
+	);
+	tempered_device_set_destroy( set );
+}
+
+int main( int argc, char *argv[] )
+{
+	int sweeps = ( argc > 1 ? atoi( argv[1] ) : 100 );
+	if ( sweeps <= 0 )
+	{
+		fprintf( stderr, "Usage: %s [sweeps]\n", argv[0] );
+		return 1;
+	}
+	
+	char *error = NULL;
+	if ( !tempered_init( &error ) )
+	{
+		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	
+	struct tempered_device_list *list = tempered_enumerate( &error );
+	if ( list == NULL )
+	{
+		if ( error == NULL )
+		{
+			printf( "No devices were found.\n" );
+		}
+		else
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+		}
+	}
+	else
+	{
+		int found = tempered_device_list_count( list );
+		tempered_device **devices = calloc( found, sizeof( tempered_device* ) );
+		int count = 0;
+		int i;
+		for ( i = 0; i < found; i++ )
+		{
+			devices[count] = tempered_open( &list[i], &error );
+			if ( devices[count] == NULL )
+			{
+				fprintf( stderr, "%s: Open failed: %s\n", list[i].path, error );
+				free( error );
+				continue;
+			}
+			count++;
+		}
+		tempered_free_device_list( list );
+		if ( count > 0 )
+		{
+			bench_devices( devices, count, sweeps, false );
+			bench_devices( devices, count, sweeps, true );
+		}
+		while ( count > 0 )
+		{
+			tempered_close( devices[--count] );
+		}
+		free( devices );
+	}
+	
+	if ( !tempered_exit( &error ) )
+	{
+		fprintf( stderr, "Failed to shut down libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <tempered.h>
+
+/**
+This example checks that reading the attached devices does not allocate any
+memory once they have been opened and read once. It reads them one by one,
+then all at once with a device set using epoll, and then with io_uring, and
+counts the calls to the allocation functions during each of those. The number
+of reads can be given as an argument.
+
+Run it with TEMPERED_TRANSPORT=sim to check the library without any devices,
+and with TEMPERED_TRANSPORT=hidraw to check the io_uring path as well, since
+io_uring is only used with the hidraw transport.
+
+The allocation functions are counted by replacing them with ones that call
+the glibc internals, so this only works with glibc.
+*/
+
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t count, size_t size );
+extern void *__libc_realloc( void *ptr, size_t size );
+extern void *__libc_memalign( size_t alignment, size_t size );
+
+/** Whether the allocations are being counted. */
+static bool counting = false;
+
+/** The number of allocations that were counted. */
+static int allocations = 0;
+
+/** Count an allocation, if they are being counted. */
+static void count_allocation( void )
+{
+	if ( __atomic_load_n( &counting, __ATOMIC_RELAXED ) )
+	{
+		__atomic_fetch_add( &allocations, 1, __ATOMIC_RELAXED );
+	}
+}
+
+void *malloc( size_t size )
+{
+	count_allocation();
+	return __libc_malloc( size );
+}
+
+void *calloc( size_t count, size_t size )
+{
+	count_allocation();
+	return __libc_calloc( count, size );
+}
+
+void *realloc( void *ptr, size_t size )
+{
+	count_allocation();
+	return __libc_realloc( ptr, size );
+}
+
+int posix_memalign( void **ptr, size_t alignment, size_t size )
+{
+	count_allocation();
+	*ptr = __libc_memalign( alignment, size );
+	return ( *ptr == NULL ? ENOMEM : 0 );
+}
+
+void *aligned_alloc( size_t alignment, size_t size )
+{
+	count_allocation();
+	return __libc_memalign( alignment, size );
+}
+
+/** Start counting the allocations. */
+void start_counting( void )
+{
+	__atomic_store_n( &allocations, 0, __ATOMIC_RELAXED );
+	__atomic_store_n( &counting, true, __ATOMIC_RELAXED );
+}
+
+/** Stop counting the allocations, and print how many there were.
+ * @return Whether or not there were none.
+ */
+bool stop_counting( char const *name, int reads, long succeeded )
+{
+	__atomic_store_n( &counting, false, __ATOMIC_RELAXED );
+	int count = __atomic_load_n( &allocations, __ATOMIC_RELAXED );
+	printf(
+		"%-9s %ld of %d reads succeeded, %d allocations\n",
+		name, succeeded, reads, count
+	);
+	return count == 0;
+}
+
+/** Read the given devices one at a time, and get their readings.
+ * @return The number of devices that were read successfully.
+ */
+int read_devices( tempered_device **devices, int count )
+{
+	struct tempered_reading readings[16];
+	int succeeded = 0;
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		if (
+			tempered_read_sensors( devices[i] ) &&
+			tempered_get_readings( devices[i], readings, 16 ) >= 0
+		) {
+			succeeded++;
+		}
+	}
+	return succeeded;
+}
+
+/** Count the allocations of reading the given devices one by one.
+ * @return Whether or not there were none.
+ */
+bool count_single( tempered_device **devices, int count, int sweeps )
+{
+	// The first read of each device sets it up, so leave it out.
+	read_devices( devices, count );
+	long succeeded = 0;
+	start_counting();
+	int i;
+	for ( i = 0; i < sweeps; i++ )
+	{
+		succeeded += read_devices( devices, count );
+	}
+	return stop_counting( "single", sweeps * count, succeeded );
+}
+
+/** Count the allocations of reading the given devices with a device set.
+ * @return Whether or not there were none (or the set could not be used).
+ */
+bool count_set(
+	tempered_device **devices, int count, int sweeps, bool use_uring
+) {
+	char *error = NULL;
+	tempered_device_set *set = tempered_device_set_create( &error );
+	if ( set == NULL )
+	{
+		fprintf( stderr, "Failed to create the device set: %s\n", error );
+		free( error );
+		return false;
+	}
+	if ( tempered_device_set_use_uring( set, use_uring ) != use_uring )
+	{
+		printf( "io_uring: not supported by this build.\n" );
+		tempered_device_set_destroy( set );
+		return true;
+	}
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		if ( !tempered_device_set_add( set, devices[i] ) )
+		{
+			fprintf(
+				stderr, "%s: Failed to add to the set: %s\n",
+				tempered_get_device_path( devices[i] ),
+				tempered_error( devices[i] )
+			);
+		}
+	}
+	// The first sweep sets everything up, so leave it out.
+	tempered_device_set_read_all( set, -1 );
+	long succeeded = 0;
+	start_counting();
+	for ( i = 0; i < sweeps; i++ )
+	{
+		succeeded += tempered_device_set_read_all( set, -1 );
+	}
+	bool result = stop_counting(
+		use_uring ? "io_uring" : "epoll", sweeps * count, succeeded
+	);
+	tempered_device_set_destroy( set );
+	return result;
+}
+
+int main( int argc, char *argv[] )
+{
+	int sweeps = ( argc > 1 ? atoi( argv[1] ) : 100 );
+	if ( sweeps <= 0 )
+	{
+		fprintf( stderr, "Usage: %s [reads]\n", argv[0] );
+		return 1;
+	}
+	
+	char *error = NULL;
+	if ( !tempered_init( &error ) )
+	{
+		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	
+	bool ok = false;
+	struct tempered_device_list *list = tempered_enumerate( &error );
+	if ( list == NULL )
+	{
+		if ( error == NULL )
+		{
+			printf( "No devices were found.\n" );
+		}
+		else
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+		}
+	}
+	else
+	{
+		int found = tempered_device_list_count( list );
+		tempered_device **devices = calloc( found, sizeof( tempered_device* ) );
+		int count = 0;
+		int i;
+		for ( i = 0; i < found; i++ )
+		{
+			devices[count] = tempered_open( &list[i], &error );
+			if ( devices[count] == NULL )
+			{
+				fprintf( stderr, "%s: Open failed: %s\n", list[i].path, error );
+				free( error );
+				continue;
+			}
+			count++;
+		}
+		tempered_free_device_list( list );
+		if ( count > 0 )
+		{
+			ok = count_single( devices, count, sweeps );
+			ok = count_set( devices, count, sweeps, false ) && ok;
+			ok = count_set( devices, count, sweeps, true ) && ok;
+		}
+		while ( count > 0 )
+		{
+			tempered_close( devices[--count] );
+		}
+		free( devices );
+	}
+	
+	if ( !tempered_exit( &error ) )
+	{
+		fprintf( stderr, "Failed to shut down libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	return ( ok ? 0 : 1 );
+}
@@ -19,8 +19,15 @@ int main( void )
 	struct tempered_device_list *list = tempered_enumerate( &error );
 	if ( list == NULL )
 	{
-		fprintf( stderr, "%s\n", error );
-		free( error );
+		if ( error == NULL )
+		{
+			printf( "No devices were found.\n" );
+		}
+		else
+		{
+			fprintf( stderr, "%s\n", error );
+			free( error );
+		}
 	}
 	else
 	{
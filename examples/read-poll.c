@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <tempered.h>
+
+/**
+This example shows how to read the sensors of all the attached devices at the
+same time, using poll() to wait for the results instead of blocking on each
+device in turn.
+*/
+
+/** Print the temperature of each sensor of the given device. */
+void print_device( tempered_device *device )
+{
+	int sensor, sensors = tempered_get_sensor_count( device );
+	for ( sensor = 0; sensor < sensors; sensor++ )
+	{
+		float tempC;
+		if ( tempered_get_temperature( device, sensor, &tempC ) )
+		{
+			printf(
+				"%s %i: %.2f°C\n",
+				tempered_get_device_path( device ), sensor, tempC
+			);
+		}
+	}
+}
+
+/** Read all the given devices at once. */
+void read_devices( tempered_device **devices, int count )
+{
+	struct pollfd *fds = calloc( count, sizeof( struct pollfd ) );
+	int i, pending = 0;
+	for ( i = 0; i < count; i++ )
+	{
+		fds[i].fd = -1;
+		if ( !tempered_read_sensors_start( devices[i] ) )
+		{
+			fprintf(
+				stderr, "%s: Failed to start reading: %s\n",
+				tempered_get_device_path( devices[i] ),
+				tempered_error( devices[i] )
+			);
+			continue;
+		}
+		fds[i].fd = tempered_get_pollfd( devices[i] );
+		fds[i].events = POLLIN;
+		pending++;
+	}
+	int waited = 0;
+	while ( pending > 0 && waited < 1000 )
+	{
+		// Devices without a poll fd must be checked periodically instead.
+		if ( poll( fds, count, 10 ) == 0 )
+		{
+			waited += 10;
+			for ( i = 0; i < count; i++ )
+			{
+				fds[i].revents = ( fds[i].events ? POLLIN : 0 );
+			}
+		}
+		for ( i = 0; i < count; i++ )
+		{
+			if ( !( fds[i].revents & POLLIN ) )
+			{
+				continue;
+			}
+			int status = tempered_read_sensors_finish( devices[i] );
+			if ( status == TEMPERED_READ_PENDING )
+			{
+				continue;
+			}
+			if ( status == TEMPERED_READ_DONE )
+			{
+				print_device( devices[i] );
+			}
+			else
+			{
+				fprintf(
+					stderr, "%s: Failed to read the sensors: %s\n",
+					tempered_get_device_path( devices[i] ),
+					tempered_error( devices[i] )
+				);
+			}
+			fds[i].fd = -1;
+			fds[i].events = 0;
+			pending--;
+		}
+	}
+	for ( i = 0; i < count; i++ )
+	{
+		if ( fds[i].events )
+		{
+			fprintf(
+				stderr, "%s: Timed out reading the sensors.\n",
+				tempered_get_device_path( devices[i] )
+			);
+		}
+	}
+	free( fds );
+}
+
+int main( void )
+{
+	char *error = NULL;
+	if ( !tempered_init( &error ) )
+	{
+		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	
+	struct tempered_device_list *list = tempered_enumerate( &error );
+	if ( list == NULL )
+	{
+		if ( error == NULL )
+		{
+			printf( "No devices were found.\n" );
+		}
+		else
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+		}
+	}
+	else
+	{
+		int count = 0;
+		struct tempered_device_list *dev;
+		for ( dev = list ; dev != NULL ; dev = dev->next )
+		{
+			count++;
+		}
+		tempered_device **devices = calloc( count, sizeof( tempered_device* ) );
+		count = 0;
+		for ( dev = list ; dev != NULL ; dev = dev->next )
+		{
+			devices[count] = tempered_open( dev, &error );
+			if ( devices[count] == NULL )
+			{
+				fprintf( stderr, "%s: Open failed: %s\n", dev->path, error );
+				free( error );
+				continue;
+			}
+			count++;
+		}
+		tempered_free_device_list( list );
+		read_devices( devices, count );
+		while ( count > 0 )
+		{
+			tempered_close( devices[--count] );
+		}
+		free( devices );
+	}
+	
+	if ( !tempered_exit( &error ) )
+	{
+		fprintf( stderr, "Failed to shut down libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	return 0;
+}
@@ -1,129 +1,113 @@
 #include <stdlib.h>
 #include <stdio.h>
-#include <unistd.h>
 #include <string.h>
+#include <poll.h>
 #include <tempered.h>
 
 /**
 This example shows how to open a single device, and read its sensors repeatedly.
+Instead of sleeping between reads, it lets a sampler read the device every five
+seconds, and waits for the samples with poll(), so the reads stay evenly spaced
+and the waiting could be part of a larger event loop.
 */
 
-/** Get and print the sensor values for a given device and sensor. */
-void read_device_sensor( tempered_device *device, int sensor )
+/** The number of samples to print before stopping. */
+#define SAMPLE_COUNT 10
+
+/** Print the values of a sensor from a sample. */
+void print_reading( struct tempered_reading const *reading )
 {
-	printf( "Sensor %i:", sensor );
-	int type = tempered_get_sensor_type( device, sensor );
-	if ( type == TEMPERED_SENSOR_TYPE_NONE )
+	printf( "Sensor %i:", reading->sensor );
+	if ( reading->type == TEMPERED_SENSOR_TYPE_NONE )
 	{
 		printf( " No such sensor, or type is not supported.\n" );
 		return;
 	}
-	if ( type & TEMPERED_SENSOR_TYPE_TEMPERATURE )
+	if ( reading->type & TEMPERED_SENSOR_TYPE_TEMPERATURE )
 	{
-		float tempC;
-		if ( tempered_get_temperature( device, sensor, &tempC ) )
+		if ( reading->status & TEMPERED_SENSOR_TYPE_TEMPERATURE )
 		{
-			printf( " %.2f°C", tempC );
+			printf( " %.2f°C", reading->tempC );
 		}
 		else
 		{
-			printf(
-				" temperature failed (%s)",
-				tempered_error( device )
-			);
+			printf( " temperature failed" );
 		}
 	}
-	if ( type & TEMPERED_SENSOR_TYPE_HUMIDITY )
+	if ( reading->type & TEMPERED_SENSOR_TYPE_HUMIDITY )
 	{
-		float rel_hum;
-		if ( tempered_get_humidity( device, sensor, &rel_hum ) )
+		if ( reading->status & TEMPERED_SENSOR_TYPE_HUMIDITY )
 		{
-			printf( " %.1f%%RH", rel_hum );
+			printf( " %.1f%%RH", reading->rel_hum );
 		}
 		else
 		{
-			printf(
-				" humidity failed (%s)",
-				tempered_error( device )
-			);
+			printf( " humidity failed" );
 		}
 	}
 	printf( "\n" );
 }
 
-/** Get and print the sensor values for a given device repeatedly. */
-void read_repeatedly( tempered_device *device )
+/** Print the values of all the sensors from a sample. */
+void print_sample( struct tempered_sample const *sample )
 {
+	if ( sample->error != TEMPERED_ERROR_NONE )
+	{
+		printf(
+			"Failed to read the sensors: %s\n",
+			tempered_strerror( sample->error )
+		);
+		return;
+	}
 	int i;
-	for ( i = 0; i < 10; i++ )
+	for ( i = 0; i < sample->count; i++ )
 	{
-		if ( i > 0 )
-		{
-			sleep( 5 );
-		}
-		if ( !tempered_read_sensors( device ) )
-		{
-			printf(
-				"Failed to read the sensors: %s\n",
-				tempered_error( device )
-			);
-		}
-		else
-		{
-			int sensor, sensors = tempered_get_sensor_count( device );
-			for ( sensor = 0; sensor < sensors; sensor++ )
-			{
-				read_device_sensor( device, sensor );
-			}
-		}
+		print_reading( &sample->readings[i] );
 	}
 }
 
-/** Open the device with the given device path. */
-tempered_device* open_device( char *dev_path )
+/** Get and print the sensor values for a given device repeatedly. */
+void read_repeatedly( tempered_device *device )
 {
 	char *error = NULL;
-	struct tempered_device_list *list = tempered_enumerate( &error );
-	if ( list == NULL )
+	tempered_sampler *sampler = tempered_sampler_start(
+		device, 5000, SAMPLE_COUNT, &error
+	);
+	if ( sampler == NULL )
 	{
-		if ( error == NULL )
-		{
-			printf( "No devices were found.\n" );
-		}
-		else
-		{
-			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
-			free( error );
-		}
-		return NULL;
+		fprintf( stderr, "Failed to start the sampler: %s\n", error );
+		free( error );
+		return;
 	}
-	tempered_device *device = NULL;
-	bool found = false;
-	struct tempered_device_list *dev;
-	for ( dev = list ; dev != NULL ; dev = dev->next )
+	struct pollfd fd = {
+		.fd = tempered_sampler_get_fd( sampler ),
+		.events = POLLIN
+	};
+	int printed = 0;
+	while ( printed < SAMPLE_COUNT && poll( &fd, 1, -1 ) >= 0 )
 	{
-		if ( strcmp( dev->path, dev_path ) == 0 )
+		struct tempered_sample samples[SAMPLE_COUNT];
+		int i, count = tempered_sampler_pop_batch(
+			sampler, samples, SAMPLE_COUNT - printed
+		);
+		for ( i = 0; i < count; i++ )
 		{
-			found = true;
-			device = tempered_open( dev, &error );
-			break;
+			print_sample( &samples[i] );
 		}
+		printed += count;
 	}
-	tempered_free_device_list( list );
+	tempered_sampler_stop( sampler );
+}
+
+/** Open the device with the given device path. */
+tempered_device* open_device( char *dev_path )
+{
+	char *error = NULL;
+	tempered_device *device = tempered_open_path( dev_path, &error );
 	if ( device == NULL )
 	{
-		if ( found )
-		{
-			fprintf(
-				stderr, "Opening %s failed, error: %s\n",
-				dev_path, error
-			);
-			free( error );
-		}
-		else
-		{
-			fprintf( stderr, "Device not found: %s\n", dev_path );
-		}
+		fprintf( stderr, "Opening %s failed, error: %s\n", dev_path, error );
+		free( error );
 	}
 	return device;
 }
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <tempered.h>
+
+/**
+This example reads simulated devices from many threads at once, to check that
+the library is thread-safe. Build it with BUILD_WITH_TSAN turned on to have
+ThreadSanitizer check it for data races while it runs.
+
+Each of the reader threads opens and reads its own device, and now and then
+also reads a device that they all share, while the opener threads enumerate
+and open devices and change the subtype cache. The library is not initialized
+before the threads are started, so they race to initialize it as well.
+
+The simulated devices are used unless TEMPERED_TRANSPORT is set to something
+else. A directory for the subtype cache can be given as an argument.
+*/
+
+/** The number of threads that read their own device. */
+#define READERS 8
+
+/** The number of threads that enumerate and open devices. */
+#define OPENERS 4
+
+/** The number of times each reader reads its device. */
+#define READS 300
+
+/** The number of times each opener enumerates the devices. */
+#define OPENS 20
+
+/** The number of simulated devices, as a string for the transport options.
+ * The readers use the first ones, the openers the ones after those, and the
+ * last one is shared.
+ */
+#define DEVICES "12"
+
+/** The path of the device that all the readers share. */
+#define SHARED_PATH "sim:11"
+
+/** The device that all the readers also read. */
+static tempered_device *shared;
+
+/** The directory for the subtype cache, or NULL to not use one. */
+static char const *cache_directory = NULL;
+
+/** The number of reads that failed. */
+static int failed_reads = 0;
+
+/** The number of times that the library did something it shouldn't have. */
+static int errors = 0;
+
+/** Report that the library did something it shouldn't have. */
+void report_error( char const *message, tempered_device *device )
+{
+	fprintf(
+		stderr, "%s: %s\n", tempered_get_device_path( device ), message
+	);
+	__atomic_fetch_add( &errors, 1, __ATOMIC_RELAXED );
+}
+
+/** Read the given device, and check that an error is set if it failed. */
+void read_device( tempered_device *device )
+{
+	struct tempered_reading readings[4];
+	float value;
+	if (
+		!tempered_read_sensors( device ) ||
+		!tempered_get_temperature( device, 0, &value )
+	) {
+		char *message = tempered_error( device );
+		if (
+			message == NULL || message[0] == '\0' ||
+			tempered_errno( device ) == TEMPERED_ERROR_NONE
+		) {
+			report_error( "A read failed without an error.", device );
+		}
+		__atomic_fetch_add( &failed_reads, 1, __ATOMIC_RELAXED );
+	}
+	tempered_get_readings( device, readings, 4 );
+}
+
+/** The main function of the reader threads. */
+void* reader_main( void *data )
+{
+	char path[32];
+	char *error = NULL;
+	snprintf( path, sizeof( path ), "sim:%ld", (long) data );
+	tempered_device *device = tempered_open_path( path, &error );
+	if ( device == NULL )
+	{
+		fprintf( stderr, "%s: Open failed: %s\n", path, error );
+		free( error );
+		__atomic_fetch_add( &errors, 1, __ATOMIC_RELAXED );
+		return NULL;
+	}
+	int i;
+	for ( i = 0; i < READS; i++ )
+	{
+		read_device( device );
+		float value;
+		tempered_get_temperature( device, 7, &value );
+		if ( tempered_errno( device ) != TEMPERED_ERROR_SENSOR_RANGE )
+		{
+			report_error( "A missing sensor was not reported.", device );
+		}
+		if ( i % 10 == 0 )
+		{
+			read_device( shared );
+			tempered_get_timeout( shared );
+		}
+	}
+	tempered_close( device );
+	return NULL;
+}
+
+/** The main function of the opener threads. */
+void* opener_main( void *data )
+{
+	(void) data;
+	int i;
+	for ( i = 0; i < OPENS; i++ )
+	{
+		char *error = NULL;
+		struct tempered_device_list *list = tempered_enumerate( &error );
+		if ( list == NULL )
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+			__atomic_fetch_add( &errors, 1, __ATOMIC_RELAXED );
+			return NULL;
+		}
+		tempered_set_subtype_cache( i % 2 ? cache_directory : NULL, NULL );
+		// Open one of the devices that the readers don't use.
+		int index = READERS + i % 3;
+		if ( index < tempered_device_list_count( list ) )
+		{
+			tempered_device *device = tempered_open( &list[index], &error );
+			if ( device != NULL )
+			{
+				tempered_close( device );
+			}
+			else
+			{
+				free( error );
+			}
+		}
+		tempered_free_device_list( list );
+	}
+	return NULL;
+}
+
+int main( int argc, char *argv[] )
+{
+	if ( argc > 2 )
+	{
+		fprintf( stderr, "Usage: %s [subtype-cache-directory]\n", argv[0] );
+		return 1;
+	}
+	if ( argc > 1 )
+	{
+		cache_directory = argv[1];
+	}
+	setenv( "TEMPERED_TRANSPORT", "sim:devices=" DEVICES, 0 );
+	
+	pthread_t threads[READERS + OPENERS];
+	long i;
+	for ( i = 0; i < OPENERS; i++ )
+	{
+		pthread_create( &threads[READERS + i], NULL, opener_main, NULL );
+	}
+	char *error = NULL;
+	shared = tempered_open_path( SHARED_PATH, &error );
+	if ( shared == NULL )
+	{
+		fprintf( stderr, "Failed to open the shared device: %s\n", error );
+		free( error );
+		for ( i = 0; i < OPENERS; i++ )
+		{
+			pthread_join( threads[READERS + i], NULL );
+		}
+		return 1;
+	}
+	for ( i = 0; i < READERS; i++ )
+	{
+		pthread_create( &threads[i], NULL, reader_main, (void *) i );
+	}
+	for ( i = 0; i < READERS + OPENERS; i++ )
+	{
+		pthread_join( threads[i], NULL );
+	}
+	tempered_close( shared );
+	
+	printf(
+		"%d threads, %d failed reads, %d errors\n",
+		READERS + OPENERS, failed_reads, errors
+	);
+	if ( !tempered_exit( &error ) )
+	{
+		fprintf( stderr, "Failed to shut down libtempered: %s\n", error );
+		free( error );
+		return 1;
+	}
+	return ( errors == 0 ? 0 : 1 );
+}
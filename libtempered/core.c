@@ -2,26 +2,15 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "tempered.h"
 #include "tempered-internal.h"
 
 #include "temper_type.h"
 
-/** Set the last error message on the given device. */
-void tempered_set_error( tempered_device *device, char *error )
-{
-	if ( device == NULL )
-	{
-		return;
-	}
-	if ( device->error != NULL )
-	{
-		free( device->error );
-	}
-	device->error = error;
-}
-
 /** Initialize the TEMPered library. */
 bool tempered_init( char **error )
 {
@@ -34,22 +23,67 @@ bool tempered_exit( char **error )
 	return temper_type_exit( error );
 }
 
+/** Select the transport used to talk to the devices. */
+bool tempered_set_transport( char const *name, char **error )
+{
+	return temper_type_set_transport( name, error );
+}
+
 /** Enumerate the TEMPer devices. */
 struct tempered_device_list* tempered_enumerate( char **error )
 {
 	return temper_type_enumerate( error );
 }
 
-/** Free the memory used by the given device list. */
-void tempered_free_device_list( struct tempered_device_list *list )
+/** Lock the given device for use by the calling thread. */
+void tempered_lock( tempered_device *device )
 {
-	while ( list != NULL )
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_lock( &device->mutex );
+#else
+	(void)device;
+#endif
+}
+
+/** Unlock the given device. */
+void tempered_unlock( tempered_device *device )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_unlock( &device->mutex );
+#else
+	(void)device;
+#endif
+}
+
+/** Helper function for open: create the lock of the given device. */
+static bool tempered_open__init_lock( tempered_device *device )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutexattr_t attr;
+	if ( pthread_mutexattr_init( &attr ) != 0 )
 	{
-		struct tempered_device_list *next = list->next;
-		free( list->path );
-		free( list );
-		list = next;
+		return false;
 	}
+	bool result = (
+		pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE ) == 0 &&
+		pthread_mutex_init( &device->mutex, &attr ) == 0
+	);
+	pthread_mutexattr_destroy( &attr );
+	return result;
+#else
+	(void)device;
+	return true;
+#endif
+}
+
+/** Helper function for open and close: destroy the lock of the given device. */
+static void tempered_destroy_lock( tempered_device *device )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_destroy( &device->mutex );
+#else
+	(void)device;
+#endif
 }
 
 /** Helper function for open: find the device subtype and set it. */
@@ -62,13 +96,21 @@ static bool tempered_open__find_subtype( tempered_device *device )
 	else
 	{
 		unsigned char subtype_id;
+		if ( tempered_subtype_cache_load( device, &subtype_id ) )
+		{
+			// The cache only holds known subtypes, so this can't fail.
+			device->subtype = temper_type_find_subtype(
+				device->type, subtype_id
+			);
+			return true;
+		}
 		if ( !device->type->get_subtype_id( device, &subtype_id ) )
 		{
-			if ( device->error == NULL )
+			if ( device->error_code == TEMPERED_ERROR_NONE )
 			{
-				tempered_set_error(
-					device,
-					strdup( "Getting the subtype ID from the device failed." )
+				tempered_set_error_code(
+					device, TEMPERED_ERROR_OTHER,
+					"getting the subtype ID from the device failed", 0
 				);
 			}
 			return false;
@@ -76,20 +118,13 @@ static bool tempered_open__find_subtype( tempered_device *device )
 		device->subtype = temper_type_find_subtype( device->type, subtype_id );
 		if ( device->subtype == NULL )
 		{
-			int size = snprintf(
-				NULL, 0, "Unknown device subtype ID: 0x%02x",
-				subtype_id
-			);
-			// TODO: check that size >= 0
-			size++;
-			char *error = malloc( size );
-			size = snprintf(
-				error, size, "Unknown device subtype ID: 0x%02x",
-				subtype_id
+			tempered_set_error_message(
+				device, TEMPERED_ERROR_OTHER,
+				"Unknown device subtype ID: 0x%02x", subtype_id
 			);
-			tempered_set_error( device, error );
 			return false;
 		}
+		tempered_subtype_cache_store( device, subtype_id );
 	}
 	return true;
 }
@@ -133,10 +168,26 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 		}
 		return NULL;
 	}
+	if ( !tempered_open__init_lock( device ) )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not create the lock for the device." );
+		}
+		free( device );
+		return NULL;
+	}
 	device->type = type;
 	device->subtype = NULL;
 	device->error = NULL;
+	device->error_code = TEMPERED_ERROR_NONE;
 	device->data = NULL;
+	tempered_latency_init( &device->latency );
+	device->stale_reports = 0;
+	device->mismatched_reports = 0;
+	device->read_time = 0;
+	device->sequence = 0;
+	device->shared_sequence = 0;
 	device->path = strdup( list->path );
 	if ( device->path == NULL )
 	{
@@ -144,16 +195,18 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 		{
 			*error = strdup( "Could not allocate memory for the path." );
 		}
+		tempered_destroy_lock( device );
 		free( device );
 		return NULL;
 	}
 	if ( !device->type->open( device ) )
 	{
+		char *open_error = tempered_take_error( device );
 		if ( error != NULL )
 		{
-			if ( device->error != NULL )
+			if ( open_error != NULL )
 			{
-				*error = device->error;
+				*error = open_error;
 			}
 			else
 			{
@@ -162,10 +215,11 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 				);
 			}
 		}
-		else if ( device->error != NULL )
+		else
 		{
-			free( device->error );
+			free( open_error );
 		}
+		tempered_destroy_lock( device );
 		free( device->path );
 		free( device );
 		return NULL;
@@ -174,8 +228,7 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 	{
 		if ( error != NULL )
 		{
-			*error = device->error;
-			device->error = NULL;
+			*error = tempered_take_error( device );
 		}
 		tempered_close( device );
 		return NULL;
@@ -186,18 +239,17 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 		{
 			if ( error != NULL )
 			{
-				if ( device->error != NULL )
-				{
-					*error = device->error;
-					device->error = NULL;
-				}
-				else
+				*error = tempered_take_error( device );
+				if ( *error == NULL )
 				{
 					*error = strdup(
 						"Type-specific device open failed with no error message."
 					);
 				}
 			}
+			// In case the subtype came from the cache and was wrong, make sure
+			// the next open asks the device again.
+			tempered_subtype_cache_forget( device );
 			device->subtype = NULL;
 			tempered_close( device );
 			return NULL;
@@ -206,6 +258,33 @@ tempered_device* tempered_open( struct tempered_device_list *list, char **error
 	return device;
 }
 
+/** Open the device with the given path, without enumerating the devices. */
+tempered_device* tempered_open_path( char const *path, char **error )
+{
+	if ( path == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Invalid device path given." );
+		}
+		return NULL;
+	}
+	struct tempered_device_list entry = {
+		.next = NULL,
+		.path = (char *) path,
+		.type_name = NULL
+	};
+	if (
+		!temper_type_identify_path(
+			path, &entry.vendor_id, &entry.product_id, &entry.interface_number,
+			error
+		)
+	) {
+		return NULL;
+	}
+	return tempered_open( &entry, error );
+}
+
 /** Close an open device. */
 void tempered_close( tempered_device *device )
 {
@@ -225,14 +304,30 @@ void tempered_close( tempered_device *device )
 	{
 		free( device->error );
 	}
+	tempered_destroy_lock( device );
 	free( device->path );
 	free( device );
 }
 
-/** Get the last error message from an open device. */
-char* tempered_error( tempered_device *device )
-{
-	return device->error;
+/** Get the number of reports that have been discarded for the given device. */
+bool tempered_get_discarded_reports(
+	tempered_device *device, unsigned int *stale, unsigned int *mismatched
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	tempered_lock( device );
+	if ( stale != NULL )
+	{
+		*stale = device->stale_reports;
+	}
+	if ( mismatched != NULL )
+	{
+		*mismatched = device->mismatched_reports;
+	}
+	tempered_unlock( device );
+	return true;
 }
 
 /** Get the device path of the given device. */
@@ -270,7 +365,7 @@ int tempered_get_sensor_type( tempered_device *device, int sensor )
 	}
 	if ( sensor < 0 || sensor >= tempered_get_sensor_count( device ) )
 	{
-		tempered_set_error( device, strdup( "Sensor ID is out of range." ) );
+		tempered_set_error_code( device, TEMPERED_ERROR_SENSOR_RANGE, NULL, 0 );
 		return TEMPERED_SENSOR_TYPE_NONE;
 	}
 	if ( device->subtype->get_sensor_type != NULL )
@@ -284,6 +379,14 @@ int tempered_get_sensor_type( tempered_device *device, int sensor )
 	return TEMPERED_SENSOR_TYPE_TEMPERATURE;
 }
 
+/** Record that the sensor values of the given device were just read. */
+static void tempered_read_done( tempered_device *device )
+{
+	device->read_time = tempered_monotonic_ns();
+	device->sequence++;
+	device->shared_sequence = 0;
+}
+
 /** Read the sensors of the given device. */
 bool tempered_read_sensors( tempered_device *device )
 {
@@ -293,12 +396,203 @@ bool tempered_read_sensors( tempered_device *device )
 	}
 	if ( device->subtype->read_sensors == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "This device type cannot read its sensors." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED, "reading the sensors", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->subtype->read_sensors( device );
+	if ( result )
+	{
+		tempered_read_done( device );
+	}
+	tempered_unlock( device );
+	return result;
+}
+
+/** Read the sensors of the given device, unless they were read recently. */
+bool tempered_read_sensors_cached( tempered_device *device, int max_age_ms )
+{
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( max_age_ms < 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER,
+			"the maximum age is negative", 0
 		);
 		return false;
 	}
-	return device->subtype->read_sensors( device );
+	long long max_age = max_age_ms * 1000000LL;
+	tempered_lock( device );
+	bool result = true;
+	if (
+		device->read_time == 0 ||
+		tempered_monotonic_ns() - device->read_time > max_age
+	) {
+		result = tempered_read_cache_read( device, max_age );
+	}
+	tempered_unlock( device );
+	return result;
+}
+
+/** Get the sequence number of the current sensor values of a device. */
+unsigned int tempered_get_read_sequence( tempered_device *device )
+{
+	if ( device == NULL )
+	{
+		return 0;
+	}
+	tempered_lock( device );
+	unsigned int sequence = device->sequence;
+	tempered_unlock( device );
+	return sequence;
+}
+
+/** Start reading the sensors of the given device. */
+bool tempered_read_sensors_start( tempered_device *device )
+{
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( device->subtype->read_sensors_start == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED,
+			"reading the sensors asynchronously", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->subtype->read_sensors_start( device );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Get the file descriptor to wait on for the results of a started read. */
+int tempered_get_pollfd( tempered_device *device )
+{
+	if ( device == NULL || device->type->get_pollfd == NULL )
+	{
+		return -1;
+	}
+	return device->type->get_pollfd( device );
+}
+
+/** Attach the given device to an io_uring, or detach it from it. */
+bool tempered_set_uring( tempered_device *device, struct tempered_uring *ring )
+{
+	if ( device == NULL || device->type->set_uring == NULL )
+	{
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->type->set_uring( device, ring );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Allocate a cache-aligned buffer for the given number of reports. */
+struct tempered_report* tempered_alloc_reports( int count )
+{
+	if ( count <= 0 )
+	{
+		return NULL;
+	}
+	void *reports;
+	size_t size = count * sizeof( struct tempered_report );
+	if ( posix_memalign( &reports, 64, size ) != 0 )
+	{
+		return NULL;
+	}
+	memset( reports, 0, size );
+	return (struct tempered_report *) reports;
+}
+
+/** Free a buffer that was allocated with tempered_alloc_reports. */
+void tempered_free_reports( struct tempered_report *reports )
+{
+	free( reports );
+}
+
+/** Get the number of raw reports that a device stores its sensor data in. */
+int tempered_get_report_count( tempered_device *device )
+{
+	int count = 0;
+	if ( device != NULL && device->type->get_reports != NULL )
+	{
+		tempered_lock( device );
+		device->type->get_reports( device, &count );
+		tempered_unlock( device );
+	}
+	return count;
+}
+
+/** Get the raw reports that were last read from the given device. */
+struct tempered_report* tempered_get_reports( tempered_device *device )
+{
+	int count;
+	if ( device == NULL || device->type->get_reports == NULL )
+	{
+		return NULL;
+	}
+	tempered_lock( device );
+	struct tempered_report *reports = device->type->get_reports(
+		device, &count
+	);
+	tempered_unlock( device );
+	return reports;
+}
+
+/** Make a device read its raw reports into a caller-owned buffer. */
+bool tempered_set_reports(
+	tempered_device *device, struct tempered_report *reports
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( device->type->set_reports == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED,
+			"storing the data in reports", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->type->set_reports( device, reports );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Continue a read that was started with tempered_read_sensors_start. */
+int tempered_read_sensors_finish( tempered_device *device )
+{
+	if ( device == NULL )
+	{
+		return TEMPERED_READ_ERROR;
+	}
+	if ( device->subtype->read_sensors_finish == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED,
+			"reading the sensors asynchronously", 0
+		);
+		return TEMPERED_READ_ERROR;
+	}
+	tempered_lock( device );
+	int result = device->subtype->read_sensors_finish( device );
+	if ( result == TEMPERED_READ_DONE )
+	{
+		tempered_read_done( device );
+	}
+	tempered_unlock( device );
+	return result;
 }
 
 /** Get the temperature from the given device. */
@@ -311,24 +605,27 @@ bool tempered_get_temperature(
 	}
 	if ( tempC == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "The tempC parameter cannot be NULL." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER, "tempC is NULL", 0
 		);
 		return false;
 	}
 	if ( sensor < 0 || sensor >= tempered_get_sensor_count( device ) )
 	{
-		tempered_set_error( device, strdup( "Sensor ID is out of range." ) );
+		tempered_set_error_code( device, TEMPERED_ERROR_SENSOR_RANGE, NULL, 0 );
 		return false;
 	}
 	if ( device->subtype->get_temperature == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "This device type cannot read the temperature." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED, "reading the temperature", 0
 		);
 		return false;
 	}
-	return device->subtype->get_temperature( device, sensor, tempC );
+	tempered_lock( device );
+	bool result = device->subtype->get_temperature( device, sensor, tempC );
+	tempered_unlock( device );
+	return result;
 }
 
 /** Get the relative humidity from the given device. */
@@ -341,22 +638,172 @@ bool tempered_get_humidity(
 	}
 	if ( rel_hum == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "The rel_hum parameter cannot be NULL." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER, "rel_hum is NULL", 0
 		);
 		return false;
 	}
 	if ( sensor < 0 || sensor >= tempered_get_sensor_count( device ) )
 	{
-		tempered_set_error( device, strdup( "Sensor ID is out of range." ) );
+		tempered_set_error_code( device, TEMPERED_ERROR_SENSOR_RANGE, NULL, 0 );
 		return false;
 	}
 	if ( device->subtype->get_humidity == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "This device type cannot read the humidity." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED, "reading the humidity", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->subtype->get_humidity( device, sensor, rel_hum );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Get the values of all the sensors of the given device. */
+int tempered_get_readings(
+	tempered_device *device, struct tempered_reading *readings, int max
+) {
+	if ( device == NULL )
+	{
+		return -1;
+	}
+	if ( readings == NULL || max < 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER,
+			"invalid readings array", 0
+		);
+		return -1;
+	}
+	int count = tempered_get_sensor_count( device );
+	if ( count > max )
+	{
+		count = max;
+	}
+	tempered_lock( device );
+	if ( device->subtype->get_readings != NULL )
+	{
+		count = device->subtype->get_readings( device, readings, count );
+		tempered_unlock( device );
+		return count;
+	}
+	int sensor;
+	for ( sensor = 0; sensor < count; sensor++ )
+	{
+		struct tempered_reading *reading = &readings[sensor];
+		reading->sensor = sensor;
+		reading->type = tempered_get_sensor_type( device, sensor );
+		reading->status = TEMPERED_SENSOR_TYPE_NONE;
+		float tempC = 0, rel_hum = 0;
+		if (
+			( reading->type & TEMPERED_SENSOR_TYPE_TEMPERATURE ) &&
+			tempered_get_temperature( device, sensor, &tempC )
+		) {
+			reading->status |= TEMPERED_SENSOR_TYPE_TEMPERATURE;
+		}
+		if (
+			( reading->type & TEMPERED_SENSOR_TYPE_HUMIDITY ) &&
+			tempered_get_humidity( device, sensor, &rel_hum )
+		) {
+			reading->status |= TEMPERED_SENSOR_TYPE_HUMIDITY;
+		}
+		reading->tempC = (
+			reading->status & TEMPERED_SENSOR_TYPE_TEMPERATURE ? tempC : 0
+		);
+		reading->rel_hum = (
+			reading->status & TEMPERED_SENSOR_TYPE_HUMIDITY ? rel_hum : 0
+		);
+	}
+	tempered_unlock( device );
+	return count;
+}
+
+/** Get the times at which the values of the given sensor were read. */
+bool tempered_get_reading_time(
+	tempered_device *device, int sensor, struct tempered_reading_time *time
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( time == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER, "time is NULL", 0
+		);
+		return false;
+	}
+	if ( sensor < 0 || sensor >= tempered_get_sensor_count( device ) )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_SENSOR_RANGE, NULL, 0 );
+		return false;
+	}
+	if ( device->type->get_reading_time == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED, "getting the reading time", 0
 		);
 		return false;
 	}
-	return device->subtype->get_humidity( device, sensor, rel_hum );
+	tempered_lock( device );
+	bool result = device->type->get_reading_time( device, sensor, time );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Get the raw codes that the given sensor reported. */
+bool tempered_get_raw(
+	tempered_device *device, int sensor, struct tempered_raw_reading *raw
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( raw == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER, "raw is NULL", 0
+		);
+		return false;
+	}
+	if ( sensor < 0 || sensor >= tempered_get_sensor_count( device ) )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_SENSOR_RANGE, NULL, 0 );
+		return false;
+	}
+	if ( device->type->get_raw == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NOT_SUPPORTED, "getting the raw codes", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	bool result = device->type->get_raw( device, sensor, raw );
+	tempered_unlock( device );
+	return result;
+}
+
+/** Convert the raw temperature code of a sensor to thousandths of a degree. */
+bool tempered_raw_to_milli_celsius(
+	struct tempered_raw_reading const *raw, int *milli_celsius
+) {
+	if ( raw == NULL || milli_celsius == NULL )
+	{
+		return false;
+	}
+	return temper_type_raw_to_milli_celsius( raw, milli_celsius );
+}
+
+/** Convert the raw humidity code of a sensor to thousandths of a percent. */
+bool tempered_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const *raw, int *milli_rel_hum
+) {
+	if ( raw == NULL || milli_rel_hum == NULL )
+	{
+		return false;
+	}
+	return temper_type_raw_to_milli_rel_hum( raw, milli_rel_hum );
 }
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+/** The number of entries that a builder first makes room for. */
+#define DEVICE_LIST_INITIAL_CAPACITY 8
+
+/** This struct is the single allocation that a device list lives in.
+ * It is followed by the paths of the entries.
+ */
+struct tempered_device_list_arena
+{
+	/** The number of entries in the list. */
+	int count;
+	
+	/** The entries of the list, each of which points to the next one. */
+	struct tempered_device_list entries[];
+};
+
+/** Get the arena that the given list head lives in. */
+static struct tempered_device_list_arena* device_list_arena(
+	struct tempered_device_list *list
+) {
+	return (struct tempered_device_list_arena *)(
+		(char *) list - offsetof( struct tempered_device_list_arena, entries )
+	);
+}
+
+/** Compare two list entries by path, for qsort. */
+static int device_list_compare( void const *a, void const *b )
+{
+	return strcmp(
+		( (struct tempered_device_list const *) a )->path,
+		( (struct tempered_device_list const *) b )->path
+	);
+}
+
+/** Start building a device list with the given builder. */
+void tempered_device_list_builder_init(
+	struct tempered_device_list_builder *builder
+) {
+	builder->entries = NULL;
+	builder->count = 0;
+	builder->capacity = 0;
+	builder->paths = NULL;
+	builder->paths_size = 0;
+	builder->paths_capacity = 0;
+}
+
+/** Add a device to the list that is being built. */
+bool tempered_device_list_builder_add(
+	struct tempered_device_list_builder *builder, char const *path,
+	char *type_name, unsigned short vendor_id, unsigned short product_id,
+	int interface_number
+) {
+	if ( builder->count == builder->capacity )
+	{
+		int capacity = (
+			builder->capacity == 0 ?
+				DEVICE_LIST_INITIAL_CAPACITY : builder->capacity * 2
+		);
+		struct tempered_device_list *entries = realloc(
+			builder->entries, capacity * sizeof( struct tempered_device_list )
+		);
+		if ( entries == NULL )
+		{
+			return false;
+		}
+		builder->entries = entries;
+		builder->capacity = capacity;
+	}
+	size_t length = strlen( path ) + 1;
+	if ( builder->paths_size + length > builder->paths_capacity )
+	{
+		size_t capacity = builder->paths_capacity * 2;
+		if ( capacity < builder->paths_size + length )
+		{
+			capacity = builder->paths_size + length + 256;
+		}
+		char *paths = realloc( builder->paths, capacity );
+		if ( paths == NULL )
+		{
+			return false;
+		}
+		builder->paths = paths;
+		builder->paths_capacity = capacity;
+	}
+	memcpy( builder->paths + builder->paths_size, path, length );
+	builder->paths_size += length;
+	struct tempered_device_list *entry = &builder->entries[builder->count++];
+	entry->next = NULL;
+	entry->path = NULL;
+	entry->type_name = type_name;
+	entry->vendor_id = vendor_id;
+	entry->product_id = product_id;
+	entry->interface_number = interface_number;
+	return true;
+}
+
+/** Finish building the device list, packing it into a single allocation. */
+struct tempered_device_list* tempered_device_list_builder_finish(
+	struct tempered_device_list_builder *builder, bool sort, char **error
+) {
+	if ( builder->count == 0 )
+	{
+		tempered_device_list_builder_free( builder );
+		return NULL;
+	}
+	size_t entries_size = builder->count * sizeof( struct tempered_device_list );
+	struct tempered_device_list_arena *arena = malloc(
+		sizeof( struct tempered_device_list_arena ) + entries_size
+			+ builder->paths_size
+	);
+	if ( arena == NULL )
+	{
+		tempered_device_list_builder_free( builder );
+		if ( error != NULL )
+		{
+			*error = strdup( "Unable to allocate memory for list." );
+		}
+		return NULL;
+	}
+	arena->count = builder->count;
+	memcpy( arena->entries, builder->entries, entries_size );
+	char *paths = (char *)( arena->entries + arena->count );
+	memcpy( paths, builder->paths, builder->paths_size );
+	int i;
+	for ( i = 0; i < arena->count; i++ )
+	{
+		arena->entries[i].path = paths;
+		paths += strlen( paths ) + 1;
+	}
+	if ( sort )
+	{
+		qsort(
+			arena->entries, arena->count, sizeof( struct tempered_device_list ),
+			device_list_compare
+		);
+	}
+	for ( i = 0; i < arena->count; i++ )
+	{
+		arena->entries[i].next = (
+			i + 1 < arena->count ? &arena->entries[i + 1] : NULL
+		);
+	}
+	tempered_device_list_builder_free( builder );
+	return arena->entries;
+}
+
+/** Free a device list builder without building the list. */
+void tempered_device_list_builder_free(
+	struct tempered_device_list_builder *builder
+) {
+	free( builder->entries );
+	free( builder->paths );
+	tempered_device_list_builder_init( builder );
+}
+
+/** Get the number of devices in the given device list. */
+int tempered_device_list_count( struct tempered_device_list *list )
+{
+	if ( list == NULL )
+	{
+		return 0;
+	}
+	return device_list_arena( list )->count;
+}
+
+/** Free the memory used by the given device list. */
+void tempered_free_device_list( struct tempered_device_list *list )
+{
+	if ( list != NULL )
+	{
+		free( device_list_arena( list ) );
+	}
+}
@@ -0,0 +1,658 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+#ifdef TEMPERED_HAVE_IO_URING
+#include "uring.h"
+#endif
+
+/** How many epoll events to fetch at a time. */
+#define DEVICE_SET_EVENTS 64
+
+/** The epoll event data that identifies the set's io_uring. */
+#define DEVICE_SET_URING_EVENT 0xFFFFFFFFu
+
+/** How many io_uring SQEs to make room for per device; each query takes 3. */
+#define DEVICE_SET_URING_SQES_PER_DEVICE 8
+
+/** The most io_uring SQEs to make room for. */
+#define DEVICE_SET_URING_MAX_SQES 4096
+
+/** The status of a device in the set that is still being read. */
+#define DEVICE_SET_PENDING (TEMPERED_READ_PENDING)
+
+/** This struct holds the information about one device in a device set. */
+struct tempered_device_set_entry
+{
+	/** The device itself. */
+	tempered_device *device;
+	
+	/** The file descriptor that is polled for the device, or -1 if none. */
+	int fd;
+	
+	/** The result of the last read, as one of the TEMPERED_READ_* values. */
+	int status;
+	
+	/** When the pending read times out (CLOCK_MONOTONIC ms). */
+	long long deadline;
+	
+	/** How many more times the read may be restarted after a timeout. */
+	int retries;
+	
+	/** Whether the device is attached to the set's io_uring. */
+	bool uring;
+};
+
+/** This is the actual struct the tempered_device_set opaque type is built from.
+ */
+struct tempered_device_set_
+{
+	/** The epoll instance that the devices' file descriptors are added to. */
+	int epoll_fd;
+	
+	/** The number of devices in the set. */
+	int count;
+	
+	/** The number of entries that have been allocated. */
+	int capacity;
+	
+	/** The array of count devices that are in the set. */
+	struct tempered_device_set_entry *entries;
+	
+	/** Whether to read the devices through an io_uring when they support it.
+	 */
+	bool use_uring;
+
+#ifdef TEMPERED_HAVE_IO_URING
+	/** The io_uring that the devices' queries are batched on, if any. */
+	struct tempered_uring *uring;
+#endif
+};
+
+/** Get the current CLOCK_MONOTONIC time in milliseconds. */
+static long long device_set_now( void )
+{
+	return tempered_monotonic_ns() / 1000000;
+}
+
+/** Create an empty device set. */
+tempered_device_set* tempered_device_set_create( char **error )
+{
+	tempered_device_set *set = malloc( sizeof( tempered_device_set ) );
+	if ( set == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not allocate memory for the device set." );
+		}
+		return NULL;
+	}
+	set->count = 0;
+	set->capacity = 0;
+	set->entries = NULL;
+	set->use_uring = true;
+#ifdef TEMPERED_HAVE_IO_URING
+	set->uring = NULL;
+#endif
+#ifdef __linux__
+	set->epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+	if ( set->epoll_fd < 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not create the epoll instance." );
+		}
+		free( set );
+		return NULL;
+	}
+#else
+	set->epoll_fd = -1;
+#endif
+	return set;
+}
+
+/** Destroy a device set, without closing the devices in it. */
+void tempered_device_set_destroy( tempered_device_set *set )
+{
+	if ( set == NULL )
+	{
+		return;
+	}
+#ifdef TEMPERED_HAVE_IO_URING
+	tempered_uring_destroy( set->uring );
+#endif
+	if ( set->epoll_fd >= 0 )
+	{
+		close( set->epoll_fd );
+	}
+	free( set->entries );
+	free( set );
+}
+
+/** Choose whether to read the devices of the set through an io_uring. */
+bool tempered_device_set_use_uring( tempered_device_set *set, bool enable )
+{
+	if ( set == NULL )
+	{
+		return false;
+	}
+	set->use_uring = enable;
+#ifdef TEMPERED_HAVE_IO_URING
+	return enable;
+#else
+	return false;
+#endif
+}
+
+#ifdef TEMPERED_HAVE_IO_URING
+/** Detach all the devices in the set from the set's io_uring. */
+static void device_set_detach_uring( tempered_device_set *set )
+{
+	int i;
+	for ( i = 0; i < set->count; i++ )
+	{
+		if ( set->entries[i].uring )
+		{
+			tempered_set_uring( set->entries[i].device, NULL );
+			set->entries[i].uring = false;
+		}
+	}
+}
+
+/** Attach all the devices in the set to the set's io_uring, creating it if
+ * needed; returns false (with none attached) if any of them can't be.
+ */
+static bool device_set_attach_uring( tempered_device_set *set )
+{
+	if ( !set->use_uring || set->count == 0 )
+	{
+		return false;
+	}
+	unsigned int entries = 64;
+	while (
+		entries < (unsigned int) set->count * DEVICE_SET_URING_SQES_PER_DEVICE
+		&& entries < DEVICE_SET_URING_MAX_SQES
+	) {
+		entries *= 2;
+	}
+	if (
+		set->uring != NULL &&
+		tempered_uring_get_entries( set->uring ) < entries
+	) {
+		tempered_uring_destroy( set->uring );
+		set->uring = NULL;
+	}
+	if ( set->uring == NULL )
+	{
+		set->uring = tempered_uring_create( entries, NULL );
+		if ( set->uring == NULL )
+		{
+			// Most likely a kernel without io_uring; don't try again.
+			set->use_uring = false;
+			return false;
+		}
+		struct epoll_event event = {
+			.events = EPOLLIN,
+			.data = { .u32 = DEVICE_SET_URING_EVENT }
+		};
+		if (
+			epoll_ctl(
+				set->epoll_fd, EPOLL_CTL_ADD,
+				tempered_uring_get_fd( set->uring ), &event
+			) != 0
+		) {
+			tempered_uring_destroy( set->uring );
+			set->uring = NULL;
+			set->use_uring = false;
+			return false;
+		}
+	}
+	int i;
+	for ( i = 0; i < set->count; i++ )
+	{
+		if ( !tempered_set_uring( set->entries[i].device, set->uring ) )
+		{
+			device_set_detach_uring( set );
+			return false;
+		}
+		set->entries[i].uring = true;
+	}
+	return true;
+}
+#endif
+
+/** Find the index of the given device in the set, or -1 if it isn't in it. */
+static int device_set_find( tempered_device_set *set, tempered_device *device )
+{
+	int i;
+	for ( i = 0; i < set->count; i++ )
+	{
+		if ( set->entries[i].device == device )
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/** Enable or disable the epoll notification for the given entry. */
+static bool device_set_arm(
+	tempered_device_set *set, int index, int op, bool enable
+) {
+#ifdef __linux__
+	struct epoll_event event = {
+		.events = ( enable ? EPOLLIN | EPOLLONESHOT : 0 ),
+		.data = { .u32 = index }
+	};
+	return epoll_ctl( set->epoll_fd, op, set->entries[index].fd, &event ) == 0;
+#else
+	(void) set;
+	(void) index;
+	(void) op;
+	(void) enable;
+	return true;
+#endif
+}
+
+/** Add a device to the set. */
+bool tempered_device_set_add( tempered_device_set *set, tempered_device *device )
+{
+	if ( set == NULL || device == NULL )
+	{
+		return false;
+	}
+	if ( device_set_find( set, device ) >= 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_ALREADY_ADDED, NULL, 0
+		);
+		return false;
+	}
+	if ( set->count == set->capacity )
+	{
+		int capacity = ( set->capacity == 0 ? 16 : set->capacity * 2 );
+		struct tempered_device_set_entry *entries = realloc(
+			set->entries, capacity * sizeof( struct tempered_device_set_entry )
+		);
+		if ( entries == NULL )
+		{
+			tempered_set_error_code(
+				device, TEMPERED_ERROR_NO_MEMORY, "device set", 0
+			);
+			return false;
+		}
+		set->entries = entries;
+		set->capacity = capacity;
+	}
+	struct tempered_device_set_entry *entry = &set->entries[set->count];
+	entry->device = device;
+	entry->fd = ( set->epoll_fd >= 0 ? tempered_get_pollfd( device ) : -1 );
+	entry->status = TEMPERED_READ_ERROR;
+	entry->uring = false;
+#ifdef __linux__
+	if (
+		entry->fd >= 0 &&
+		!device_set_arm( set, set->count, EPOLL_CTL_ADD, false )
+	) {
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_OTHER,
+			"could not add the device to the epoll set", errno
+		);
+		return false;
+	}
+#endif
+	set->count++;
+	return true;
+}
+
+/** Remove a device from the set. */
+bool tempered_device_set_remove(
+	tempered_device_set *set, tempered_device *device
+) {
+	if ( set == NULL )
+	{
+		return false;
+	}
+	int index = device_set_find( set, device );
+	if ( index < 0 )
+	{
+		return false;
+	}
+#ifdef __linux__
+	if ( set->entries[index].fd >= 0 )
+	{
+		epoll_ctl(
+			set->epoll_fd, EPOLL_CTL_DEL, set->entries[index].fd, NULL
+		);
+	}
+#endif
+	set->count--;
+	if ( index < set->count )
+	{
+		// Move the last entry into the hole, and tell epoll its new index.
+		set->entries[index] = set->entries[set->count];
+#ifdef __linux__
+		if ( set->entries[index].fd >= 0 )
+		{
+			device_set_arm(
+				set, index, EPOLL_CTL_MOD,
+				set->entries[index].status == DEVICE_SET_PENDING
+			);
+		}
+#endif
+	}
+	return true;
+}
+
+/** Continue reading the device at the given index; returns true when done. */
+static bool device_set_finish( tempered_device_set *set, int index )
+{
+	struct tempered_device_set_entry *entry = &set->entries[index];
+	int status = tempered_read_sensors_finish( entry->device );
+	if ( status == TEMPERED_READ_PENDING )
+	{
+#ifdef __linux__
+		if ( entry->fd >= 0 && !entry->uring )
+		{
+			device_set_arm( set, index, EPOLL_CTL_MOD, true );
+		}
+#endif
+		return false;
+	}
+	entry->status = status;
+	return true;
+}
+
+/** Start reading the device at the given index; returns true if the read is
+ * pending. A device that cannot be read asynchronously is read right away,
+ * in which case its read has already ended when this returns false.
+ */
+static bool device_set_start(
+	tempered_device_set *set, int index, int timeout, long long now
+) {
+	struct tempered_device_set_entry *entry = &set->entries[index];
+#ifdef TEMPERED_HAVE_IO_URING
+	if ( entry->uring )
+	{
+		// The ring times out the read of the response at the deadline.
+		tempered_uring_set_timeout(
+			set->uring, timeout < 0 ?
+				tempered_latency_get_timeout( entry->device ) : timeout
+		);
+	}
+#endif
+	if ( !tempered_read_sensors_start( entry->device ) )
+	{
+		entry->status = TEMPERED_READ_ERROR;
+		if (
+			tempered_errno( entry->device ) == TEMPERED_ERROR_NOT_SUPPORTED &&
+			tempered_read_sensors( entry->device )
+		) {
+			// This device can only be read synchronously, so it was.
+			entry->status = TEMPERED_READ_DONE;
+		}
+		return false;
+	}
+	entry->status = DEVICE_SET_PENDING;
+	entry->deadline = now + (
+		timeout < 0 ? tempered_latency_get_timeout( entry->device ) : timeout
+	);
+#ifdef __linux__
+	if ( entry->uring )
+	{
+		// The ring tells us when the response has been read.
+		return true;
+	}
+	if ( entry->fd >= 0 && !device_set_arm( set, index, EPOLL_CTL_MOD, true ) )
+	{
+		// We can't be told when it's ready, so check it periodically.
+		entry->fd = -1;
+	}
+#endif
+	return true;
+}
+
+#ifdef TEMPERED_HAVE_IO_URING
+/** Process the completions of the set's io_uring, and continue reading the
+ * devices that were waiting for them; returns the number of reads that ended.
+ */
+static int device_set_reap_uring( tempered_device_set *set )
+{
+	if ( tempered_uring_reap( set->uring ) == 0 )
+	{
+		return 0;
+	}
+	int i, ended = 0;
+	for ( i = 0; i < set->count; i++ )
+	{
+		struct tempered_device_set_entry *entry = &set->entries[i];
+		if (
+			entry->uring && entry->status == DEVICE_SET_PENDING &&
+			device_set_finish( set, i )
+		) {
+			ended++;
+		}
+	}
+	return ended;
+}
+#endif
+
+/** Handle the pending devices whose deadline has passed, restarting their read
+ * if they have any retries left; returns the number of reads that were ended.
+ */
+static int device_set_expire(
+	tempered_device_set *set, int timeout, long long now
+) {
+	int i, ended = 0;
+	for ( i = 0; i < set->count; i++ )
+	{
+		struct tempered_device_set_entry *entry = &set->entries[i];
+		if ( entry->status != DEVICE_SET_PENDING || entry->deadline > now )
+		{
+			continue;
+		}
+		if ( timeout < 0 )
+		{
+			tempered_latency_timeout( entry->device );
+		}
+		if ( entry->retries > 0 )
+		{
+			entry->retries--;
+			if ( device_set_start( set, i, timeout, now ) )
+			{
+				continue;
+			}
+		}
+		else
+		{
+			entry->status = TEMPERED_READ_ERROR;
+			tempered_set_error_code(
+				entry->device, TEMPERED_ERROR_TIMEOUT, NULL, 0
+			);
+		}
+		ended++;
+	}
+	return ended;
+}
+
+/** Read the sensors of all the devices in the set at the same time. */
+int tempered_device_set_read_all( tempered_device_set *set, int timeout )
+{
+	if ( set == NULL )
+	{
+		return 0;
+	}
+#ifdef TEMPERED_HAVE_IO_URING
+	bool uring = device_set_attach_uring( set );
+#endif
+	long long now = device_set_now();
+	int i, pending = 0, succeeded = 0;
+	for ( i = 0; i < set->count; i++ )
+	{
+		struct tempered_device_set_entry *entry = &set->entries[i];
+		entry->retries = ( timeout < 0 ? entry->device->latency.retries : 0 );
+		if ( device_set_start( set, i, timeout, now ) )
+		{
+			pending++;
+		}
+	}
+	while ( pending > 0 )
+	{
+#ifdef TEMPERED_HAVE_IO_URING
+		if ( uring && !tempered_uring_submit( set->uring ) )
+		{
+			// Fall back to reading them one by one, when they are restarted.
+			device_set_detach_uring( set );
+			uring = false;
+		}
+#endif
+		bool without_fd = false;
+		long long deadline = -1;
+		for ( i = 0; i < set->count; i++ )
+		{
+			struct tempered_device_set_entry *entry = &set->entries[i];
+			if ( entry->status != DEVICE_SET_PENDING )
+			{
+				continue;
+			}
+			if ( deadline < 0 || entry->deadline < deadline )
+			{
+				deadline = entry->deadline;
+			}
+			if ( entry->fd < 0 && !entry->uring )
+			{
+				without_fd = true;
+			}
+		}
+		now = device_set_now();
+		long long wait = deadline - now;
+		if ( wait <= 0 )
+		{
+			pending -= device_set_expire( set, timeout, now );
+			continue;
+		}
+		if ( without_fd )
+		{
+			// Devices without a poll fd are checked every millisecond.
+			wait = 1;
+		}
+#ifdef __linux__
+		struct epoll_event events[DEVICE_SET_EVENTS];
+		int count = epoll_wait(
+			set->epoll_fd, events, DEVICE_SET_EVENTS, (int) wait
+		);
+		for ( i = 0; i < count; i++ )
+		{
+#ifdef TEMPERED_HAVE_IO_URING
+			if ( events[i].data.u32 == DEVICE_SET_URING_EVENT )
+			{
+				pending -= device_set_reap_uring( set );
+				continue;
+			}
+#endif
+			int index = events[i].data.u32;
+			if (
+				index < set->count &&
+				set->entries[index].status == DEVICE_SET_PENDING &&
+				device_set_finish( set, index )
+			) {
+				pending--;
+			}
+		}
+#else
+		struct timespec delay = { .tv_sec = 0, .tv_nsec = wait * 1000000 };
+		nanosleep( &delay, NULL );
+#endif
+		if ( !without_fd )
+		{
+			continue;
+		}
+		for ( i = 0; i < set->count; i++ )
+		{
+			struct tempered_device_set_entry *entry = &set->entries[i];
+			if (
+				entry->fd < 0 && !entry->uring &&
+				entry->status == DEVICE_SET_PENDING &&
+				device_set_finish( set, i )
+			) {
+				pending--;
+			}
+		}
+	}
+#ifdef TEMPERED_HAVE_IO_URING
+	if ( uring )
+	{
+		device_set_detach_uring( set );
+	}
+#endif
+	for ( i = 0; i < set->count; i++ )
+	{
+		if ( set->entries[i].status == TEMPERED_READ_DONE )
+		{
+			succeeded++;
+		}
+	}
+	return succeeded;
+}
+
+/** Check whether the last read of the given device in the set succeeded. */
+bool tempered_device_set_read_ok(
+	tempered_device_set *set, tempered_device *device
+) {
+	if ( set == NULL )
+	{
+		return false;
+	}
+	int index = device_set_find( set, device );
+	return index >= 0 && set->entries[index].status == TEMPERED_READ_DONE;
+}
+
+/** Get the number of reports needed to hold the raw data of the set. */
+int tempered_device_set_get_report_count( tempered_device_set *set )
+{
+	if ( set == NULL )
+	{
+		return 0;
+	}
+	int count = 0;
+	int i;
+	for ( i = 0; i < set->count; i++ )
+	{
+		count += tempered_get_report_count( set->entries[i].device );
+	}
+	return count;
+}
+
+/** Make all the devices in the set read into one caller-owned buffer. */
+bool tempered_device_set_set_reports(
+	tempered_device_set *set, struct tempered_report *reports
+) {
+	if ( set == NULL )
+	{
+		return false;
+	}
+	bool success = true;
+	int i;
+	for ( i = 0; i < set->count; i++ )
+	{
+		tempered_device *device = set->entries[i].device;
+		if ( !tempered_set_reports( device, reports ) )
+		{
+			success = false;
+		}
+		if ( reports != NULL )
+		{
+			reports += tempered_get_report_count( device );
+		}
+	}
+	return success;
+}
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+/** The generic messages for the error codes, indexed by code. */
+static char const * const tempered_error_messages[] = {
+	[TEMPERED_ERROR_NONE] = "No error",
+	[TEMPERED_ERROR_OTHER] = "Unknown error",
+	[TEMPERED_ERROR_NO_MEMORY] = "Out of memory",
+	[TEMPERED_ERROR_INVALID_PARAMETER] = "Invalid parameter",
+	[TEMPERED_ERROR_SENSOR_RANGE] = "Sensor ID is out of range",
+	[TEMPERED_ERROR_NOT_SUPPORTED] = "Not supported by this device type",
+	[TEMPERED_ERROR_SENSOR_TYPE] = "Not supported by this sensor",
+	[TEMPERED_ERROR_WRITE] = "HID write failed",
+	[TEMPERED_ERROR_READ] = "Read of data from the sensor failed",
+	[TEMPERED_ERROR_TIMEOUT] = "No data was read from the sensor (timeout)",
+	[TEMPERED_ERROR_SHORT_READ] = "Not enough data was read from the sensor",
+	[TEMPERED_ERROR_NOT_STARTED] = "No read of the sensors has been started",
+	[TEMPERED_ERROR_BUSY] = "A read of the sensors is in progress",
+	[TEMPERED_ERROR_NO_DATA] = "The data is not available yet",
+	[TEMPERED_ERROR_ALREADY_ADDED] = "The device is already in the device set",
+	[TEMPERED_ERROR_INTERNAL] = "Internal error (this should never happen)"
+};
+
+/** The number of error codes that have a message. */
+#define TEMPERED_ERROR_COUNT \
+	( (int)( sizeof( tempered_error_messages ) / sizeof( char const * ) ) )
+
+#ifdef TEMPERED_HAVE_PTHREADS
+/** The buffer that tempered_error() copies the message into, which is per
+ * thread so that the message stays valid while other threads use the device.
+ */
+static __thread char tempered_error_buffer[TEMPERED_ERROR_MESSAGE_SIZE];
+#else
+/** The buffer that tempered_error() copies the message into. */
+static char tempered_error_buffer[TEMPERED_ERROR_MESSAGE_SIZE];
+#endif
+
+/** Set the last error message on the given device. */
+void tempered_set_error( tempered_device *device, char *error )
+{
+	if ( device == NULL )
+	{
+		return;
+	}
+	tempered_lock( device );
+	if ( device->error != NULL )
+	{
+		free( device->error );
+	}
+	device->error = error;
+	device->error_code =
+		( error == NULL ? TEMPERED_ERROR_NONE : TEMPERED_ERROR_OTHER );
+	device->error_detail = NULL;
+	device->error_errnum = 0;
+	device->error_formatted = false;
+	tempered_unlock( device );
+}
+
+/** Set the last error for the given device to the given error code. */
+void tempered_set_error_code(
+	tempered_device *device, int code, char const *detail, int errnum
+) {
+	if ( device == NULL )
+	{
+		return;
+	}
+	tempered_lock( device );
+	if ( device->error != NULL )
+	{
+		free( device->error );
+		device->error = NULL;
+	}
+	device->error_code = code;
+	device->error_detail = detail;
+	device->error_errnum = errnum;
+	device->error_formatted = false;
+	tempered_unlock( device );
+}
+
+/** Set the last error for the given device to the given error code, with a
+ * message that is formatted right away.
+ */
+void tempered_set_error_message(
+	tempered_device *device, int code, char const *format, ...
+) {
+	if ( device == NULL )
+	{
+		return;
+	}
+	tempered_lock( device );
+	tempered_set_error_code( device, code, NULL, 0 );
+	va_list args;
+	va_start( args, format );
+	vsnprintf(
+		device->error_message, TEMPERED_ERROR_MESSAGE_SIZE, format, args
+	);
+	va_end( args );
+	device->error_formatted = true;
+	tempered_unlock( device );
+}
+
+/** Format the message for the last error of the given device into the given
+ * buffer; the device must be locked, and have an error.
+ */
+static void tempered_format_error( tempered_device *device, char *message )
+{
+	if ( device->error != NULL || device->error_formatted )
+	{
+		snprintf(
+			message, TEMPERED_ERROR_MESSAGE_SIZE, "%s",
+			device->error != NULL ? device->error : device->error_message
+		);
+		return;
+	}
+	int length = snprintf(
+		message, TEMPERED_ERROR_MESSAGE_SIZE, "%s",
+		tempered_strerror( device->error_code )
+	);
+	if ( device->error_detail != NULL && length < TEMPERED_ERROR_MESSAGE_SIZE )
+	{
+		length += snprintf(
+			message + length, TEMPERED_ERROR_MESSAGE_SIZE - length, ": %s",
+			device->error_detail
+		);
+	}
+	if ( device->error_errnum != 0 && length < TEMPERED_ERROR_MESSAGE_SIZE )
+	{
+		char buffer[TEMPERED_STRERROR_SIZE];
+		snprintf(
+			message + length, TEMPERED_ERROR_MESSAGE_SIZE - length, ": %s",
+			tempered_strerror_r(
+				device->error_errnum, buffer, sizeof( buffer )
+			)
+		);
+	}
+}
+
+/** Get the last error message from an open device. */
+char* tempered_error( tempered_device *device )
+{
+	tempered_lock( device );
+	char *message = NULL;
+	if ( device->error_code != TEMPERED_ERROR_NONE )
+	{
+		message = tempered_error_buffer;
+		tempered_format_error( device, message );
+	}
+	tempered_unlock( device );
+	return message;
+}
+
+/** Get the code of the last error for the given device. */
+int tempered_errno( tempered_device *device )
+{
+	tempered_lock( device );
+	int code = device->error_code;
+	tempered_unlock( device );
+	return code;
+}
+
+/** Get the generic message for the given error code. */
+char const * tempered_strerror( int code )
+{
+	if ( code < 0 || code >= TEMPERED_ERROR_COUNT )
+	{
+		return "Unknown error code";
+	}
+	return tempered_error_messages[code];
+}
+
+/** Get the text for the given errno value, like strerror() but thread-safe. */
+char const * tempered_strerror_r( int errnum, char *buffer, size_t size )
+{
+#if defined( _GNU_SOURCE ) && defined( __GLIBC__ )
+	// This is the GNU version, which may return a string constant instead.
+	return strerror_r( errnum, buffer, size );
+#else
+	if ( strerror_r( errnum, buffer, size ) != 0 )
+	{
+		snprintf( buffer, size, "Unknown error %d", errnum );
+	}
+	return buffer;
+#endif
+}
+
+/** Format a message into a newly allocated string, like asprintf(). */
+char* tempered_format_string( char const *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	int size = vsnprintf( NULL, 0, format, args );
+	va_end( args );
+	if ( size < 0 )
+	{
+		return NULL;
+	}
+	char *string = malloc( size + 1 );
+	if ( string == NULL )
+	{
+		return NULL;
+	}
+	va_start( args, format );
+	vsnprintf( string, size + 1, format, args );
+	va_end( args );
+	return string;
+}
+
+/** Take the last error message of the given device. */
+char* tempered_take_error( tempered_device *device )
+{
+	tempered_lock( device );
+	char *error = device->error;
+	if ( error != NULL )
+	{
+		device->error = NULL;
+	}
+	else if ( device->error_code != TEMPERED_ERROR_NONE )
+	{
+		error = strdup( tempered_error( device ) );
+	}
+	tempered_set_error( device, NULL );
+	tempered_unlock( device );
+	return error;
+}
@@ -0,0 +1,419 @@
+// This is needed for struct ucred, used to check who sent a device event.
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef TEMPERED_HAVE_HIDRAW
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+#include "temper_type.h"
+
+#ifdef TEMPERED_HAVE_HIDRAW
+
+/** The netlink multicast group that udev sends its device events to, after
+ * it has applied its rules (so the device nodes have the right permissions).
+ */
+#define MONITOR_UDEV_GROUP 2
+
+/** The size of the buffer that a single device event is received into. */
+#define MONITOR_BUFFER_SIZE 8192
+
+/** The prefix of the device events that are sent by udev. */
+#define MONITOR_UDEV_PREFIX "libudev"
+
+/** The magic number of the device events that are sent by udev. */
+#define MONITOR_UDEV_MAGIC 0xfeedcafe
+
+/** The header of the device events that are sent by udev. */
+struct monitor_udev_header
+{
+	/** The MONITOR_UDEV_PREFIX string, including the terminating NUL. */
+	char prefix[8];
+	
+	/** MONITOR_UDEV_MAGIC, in network byte order. */
+	unsigned int magic;
+	
+	/** The size of this header. */
+	unsigned int header_size;
+	
+	/** The offset of the event's properties from the start of the event. */
+	unsigned int properties_offset;
+	
+	/** The length of the event's properties. */
+	unsigned int properties_length;
+};
+
+/** This is the actual struct the tempered_monitor opaque type is built from.
+ */
+struct tempered_monitor_
+{
+	/** The netlink socket that the device events are received on. */
+	int fd;
+	
+	/** The list of the devices that are currently attached. */
+	struct tempered_device_list *devices;
+	
+	/** The function to call when a device is added or removed. */
+	tempered_monitor_callback callback;
+	
+	/** The user data to pass to the callback. */
+	void *user_data;
+};
+
+/** Filter for scandir() that only accepts hidraw device nodes. */
+static int monitor_filter( struct dirent const *entry )
+{
+	return strncmp( entry->d_name, "hidraw", 6 ) == 0;
+}
+
+/** Find the device with the given path in the list.
+ * @return The index of the device in the list, or -1 if it isn't in it.
+ */
+static int monitor_find( tempered_monitor *monitor, char const *path )
+{
+	int i;
+	for ( i = 0; i < tempered_device_list_count( monitor->devices ); i++ )
+	{
+		if ( strcmp( monitor->devices[i].path, path ) == 0 )
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/** Build a new device list from the current one, leaving out the device at
+ * the given index (unless that is -1) and adding the hidraw node with the
+ * given name if it is a TEMPer device (unless the name is NULL).
+ * The device list is a single allocation, so it is rebuilt on each change;
+ * those are rare enough that this costs nothing worth mentioning.
+ * @return Whether or not there was memory for the new list.
+ */
+static bool monitor_rebuild(
+	tempered_monitor *monitor, int skip, char const *name,
+	struct tempered_device_list **list
+) {
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	bool ok = true;
+	int i;
+	for ( i = 0; ok && i < tempered_device_list_count( monitor->devices ); i++ )
+	{
+		struct tempered_device_list *device = &monitor->devices[i];
+		if ( i != skip )
+		{
+			ok = tempered_device_list_builder_add(
+				&builder, device->path, device->type_name, device->vendor_id,
+				device->product_id, device->interface_number
+			);
+		}
+	}
+	if ( ok && name != NULL )
+	{
+		ok = temper_type_identify_hidraw( name, &builder );
+	}
+	if ( !ok )
+	{
+		tempered_device_list_builder_free( &builder );
+		return false;
+	}
+	int count = builder.count;
+	*list = tempered_device_list_builder_finish( &builder, false, NULL );
+	return *list != NULL || count == 0;
+}
+
+/** Handle a single device event that was received from the socket. */
+static void monitor_handle_event(
+	tempered_monitor *monitor, char *buffer, int size
+) {
+	char *properties = buffer, *end = buffer + size;
+	if (
+		size >= (int)sizeof( struct monitor_udev_header ) &&
+		strcmp( buffer, MONITOR_UDEV_PREFIX ) == 0
+	) {
+		struct monitor_udev_header *header =
+			(struct monitor_udev_header *) buffer;
+		if (
+			ntohl( header->magic ) != MONITOR_UDEV_MAGIC ||
+			header->properties_offset > (unsigned int) size ||
+			header->properties_length > size - header->properties_offset
+		) {
+			return;
+		}
+		properties = buffer + header->properties_offset;
+		end = properties + header->properties_length;
+	}
+	else
+	{
+		// A kernel event, which starts with "action@devpath".
+		properties += strnlen( buffer, size ) + 1;
+	}
+	char const *action = NULL, *subsystem = NULL, *devname = NULL;
+	while ( properties < end )
+	{
+		int length = strnlen( properties, end - properties );
+		if ( properties + length >= end )
+		{
+			break;
+		}
+		if ( strncmp( properties, "ACTION=", 7 ) == 0 )
+		{
+			action = properties + 7;
+		}
+		else if ( strncmp( properties, "SUBSYSTEM=", 10 ) == 0 )
+		{
+			subsystem = properties + 10;
+		}
+		else if ( strncmp( properties, "DEVNAME=", 8 ) == 0 )
+		{
+			devname = properties + 8;
+		}
+		properties += length + 1;
+	}
+	if (
+		action == NULL || subsystem == NULL || devname == NULL ||
+		strcmp( subsystem, "hidraw" ) != 0
+	) {
+		return;
+	}
+	// udev gives the full path of the node, while the kernel gives the name.
+	char const *name = strrchr( devname, '/' );
+	name = ( name == NULL ? devname : name + 1 );
+	char path[256 + 8];
+	snprintf( path, sizeof( path ), "/dev/%s", name );
+	int index = monitor_find( monitor, path );
+	struct tempered_device_list *list, *old = monitor->devices;
+	if ( strcmp( action, "add" ) == 0 && index < 0 )
+	{
+		// This also ignores devices we already know of from the initial scan.
+		int count = tempered_device_list_count( old );
+		if ( !monitor_rebuild( monitor, -1, name, &list ) )
+		{
+			return;
+		}
+		if ( tempered_device_list_count( list ) == count )
+		{
+			// It's not one of ours.
+			tempered_free_device_list( list );
+			return;
+		}
+		monitor->devices = list;
+		tempered_free_device_list( old );
+		if ( monitor->callback != NULL )
+		{
+			monitor->callback(
+				monitor, TEMPERED_MONITOR_ADDED, &list[count],
+				monitor->user_data
+			);
+		}
+	}
+	else if ( strcmp( action, "remove" ) == 0 && index >= 0 )
+	{
+		if ( !monitor_rebuild( monitor, index, NULL, &list ) )
+		{
+			return;
+		}
+		monitor->devices = list;
+		if ( monitor->callback != NULL )
+		{
+			old[index].next = NULL;
+			monitor->callback(
+				monitor, TEMPERED_MONITOR_REMOVED, &old[index],
+				monitor->user_data
+			);
+		}
+		tempered_free_device_list( old );
+	}
+}
+
+#endif
+
+/** Start monitoring for TEMPer devices being added and removed. */
+tempered_monitor* tempered_monitor_create(
+	tempered_monitor_callback callback, void *user_data, char **error
+) {
+#ifdef TEMPERED_HAVE_HIDRAW
+	tempered_monitor *monitor = malloc( sizeof( tempered_monitor ) );
+	if ( monitor == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not allocate memory for the monitor." );
+		}
+		return NULL;
+	}
+	monitor->devices = NULL;
+	monitor->callback = callback;
+	monitor->user_data = user_data;
+	monitor->fd = socket(
+		AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		NETLINK_KOBJECT_UEVENT
+	);
+	struct sockaddr_nl address;
+	memset( &address, 0, sizeof( address ) );
+	address.nl_family = AF_NETLINK;
+	address.nl_groups = MONITOR_UDEV_GROUP;
+	int on = 1;
+	if (
+		monitor->fd < 0 ||
+		setsockopt( monitor->fd, SOL_SOCKET, SO_PASSCRED, &on, sizeof( on ) )
+			< 0 ||
+		bind(
+			monitor->fd, (struct sockaddr *) &address, sizeof( address )
+		) < 0
+	) {
+		if ( error != NULL )
+		{
+			char buffer[TEMPERED_STRERROR_SIZE];
+			char const *text = tempered_strerror_r(
+				errno, buffer, sizeof( buffer )
+			);
+			*error = tempered_format_string(
+				"Could not listen for device events: %s", text
+			);
+		}
+		if ( monitor->fd >= 0 )
+		{
+			close( monitor->fd );
+		}
+		free( monitor );
+		return NULL;
+	}
+	// Scan the devices after starting to listen, so that none are missed;
+	// the ones that are also reported by an event are only added once.
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	struct dirent **entries;
+	int count = scandir( "/dev", &entries, monitor_filter, alphasort );
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		// Devices that there is no memory for are simply not listed.
+		temper_type_identify_hidraw( entries[i]->d_name, &builder );
+		free( entries[i] );
+	}
+	if ( count >= 0 )
+	{
+		free( entries );
+	}
+	monitor->devices = tempered_device_list_builder_finish(
+		&builder, false, NULL
+	);
+	return monitor;
+#else
+	(void) callback;
+	(void) user_data;
+	if ( error != NULL )
+	{
+		*error = strdup( "Device monitoring is not supported on this platform." );
+	}
+	return NULL;
+#endif
+}
+
+/** Stop monitoring for devices, and free the monitor. */
+void tempered_monitor_destroy( tempered_monitor *monitor )
+{
+#ifdef TEMPERED_HAVE_HIDRAW
+	if ( monitor == NULL )
+	{
+		return;
+	}
+	close( monitor->fd );
+	tempered_free_device_list( monitor->devices );
+	free( monitor );
+#else
+	(void) monitor;
+#endif
+}
+
+/** Get the file descriptor that becomes readable when devices change. */
+int tempered_monitor_get_fd( tempered_monitor *monitor )
+{
+#ifdef TEMPERED_HAVE_HIDRAW
+	return monitor == NULL ? -1 : monitor->fd;
+#else
+	(void) monitor;
+	return -1;
+#endif
+}
+
+/** Process the device events that have been received. */
+int tempered_monitor_process( tempered_monitor *monitor )
+{
+#ifdef TEMPERED_HAVE_HIDRAW
+	if ( monitor == NULL )
+	{
+		return -1;
+	}
+	int count = 0;
+	for ( ;; )
+	{
+		char buffer[MONITOR_BUFFER_SIZE];
+		char control[CMSG_SPACE( sizeof( struct ucred ) )];
+		struct sockaddr_nl sender;
+		struct iovec iov = { .iov_base = buffer, .iov_len = sizeof( buffer ) };
+		struct msghdr message = {
+			.msg_name = &sender,
+			.msg_namelen = sizeof( sender ),
+			.msg_iov = &iov,
+			.msg_iovlen = 1,
+			.msg_control = control,
+			.msg_controllen = sizeof( control )
+		};
+		int size = recvmsg( monitor->fd, &message, 0 );
+		if ( size < 0 )
+		{
+			if ( errno == EINTR )
+			{
+				continue;
+			}
+			// EAGAIN means there are no more events; ENOBUFS means some were
+			// lost, which only costs us those, so neither is an error here.
+			if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS )
+			{
+				return count;
+			}
+			return -1;
+		}
+		count++;
+		// Only trust events from udev or the kernel, which run as root.
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR( &message );
+		if (
+			( message.msg_flags & MSG_TRUNC ) || size == 0 ||
+			cmsg == NULL || cmsg->cmsg_type != SCM_CREDENTIALS ||
+			( (struct ucred *) CMSG_DATA( cmsg ) )->uid != 0
+		) {
+			continue;
+		}
+		buffer[size < MONITOR_BUFFER_SIZE ? size : MONITOR_BUFFER_SIZE - 1] =
+			'\0';
+		monitor_handle_event( monitor, buffer, size );
+	}
+#else
+	(void) monitor;
+	return -1;
+#endif
+}
+
+/** Get the list of the devices that are currently attached. */
+struct tempered_device_list* tempered_monitor_get_devices(
+	tempered_monitor *monitor
+) {
+#ifdef TEMPERED_HAVE_HIDRAW
+	return monitor == NULL ? NULL : monitor->devices;
+#else
+	(void) monitor;
+	return NULL;
+#endif
+}
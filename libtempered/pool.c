@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+#ifdef TEMPERED_HAVE_PTHREADS
+
+/** This struct holds the state of one worker thread of a pool.
+ *
+ * During a read, each worker owns a contiguous range [start, end) of the job
+ * array. The worker takes jobs from the end of its own range, while idle
+ * workers steal them from the start, so a worker that is stuck waiting for a
+ * slow device only holds up the jobs it has already taken. The range is
+ * guarded by a mutex, which costs nothing compared to a USB round trip.
+ */
+struct tempered_pool_worker
+{
+	/** The pool this worker belongs to. */
+	struct tempered_pool_ *pool;
+	
+	/** The thread that runs this worker. */
+	pthread_t thread;
+	
+	/** The mutex that guards start and end. */
+	pthread_mutex_t mutex;
+	
+	/** The index of the first job in this worker's range. */
+	int start;
+	
+	/** The index after the last job in this worker's range. */
+	int end;
+};
+
+/** This is the actual struct the tempered_pool opaque type is built from. */
+struct tempered_pool_
+{
+	/** The number of worker threads in the pool. */
+	int thread_count;
+	
+	/** The array of thread_count workers. */
+	struct tempered_pool_worker *workers;
+	
+	/** Serializes the calls to tempered_pool_read(). */
+	pthread_mutex_t read_mutex;
+	
+	/** The mutex that guards the rest of the fields below. */
+	pthread_mutex_t mutex;
+	
+	/** Signalled when a new read starts, or the pool is being destroyed. */
+	pthread_cond_t work_cond;
+	
+	/** Signalled when the last job of a read is done. */
+	pthread_cond_t done_cond;
+	
+	/** Incremented for each read, so the workers can tell a new one started. */
+	unsigned int generation;
+	
+	/** Whether the pool is being destroyed. */
+	bool shutdown;
+	
+	/** The number of jobs of the current read that are not done yet. */
+	int remaining;
+	
+	/** The number of jobs of the current read that succeeded. */
+	int succeeded;
+	
+	/** The devices to read in the current read. */
+	tempered_device **devices;
+	
+	/** The function to call for each device of the current read. */
+	tempered_pool_callback callback;
+	
+	/** The user data to pass to the callback. */
+	void *user_data;
+};
+
+/** Take a job from the end of the worker's own range, or -1 if it is empty. */
+static int pool_take( struct tempered_pool_worker *worker )
+{
+	int job = -1;
+	pthread_mutex_lock( &worker->mutex );
+	if ( worker->start < worker->end )
+	{
+		job = --worker->end;
+	}
+	pthread_mutex_unlock( &worker->mutex );
+	return job;
+}
+
+/** Steal a job from the start of another worker's range, or -1 if none. */
+static int pool_steal( struct tempered_pool_worker *worker )
+{
+	struct tempered_pool_ *pool = worker->pool;
+	int self = worker - pool->workers;
+	int i;
+	for ( i = 1; i < pool->thread_count; i++ )
+	{
+		struct tempered_pool_worker *victim =
+			&pool->workers[( self + i ) % pool->thread_count];
+		int job = -1;
+		pthread_mutex_lock( &victim->mutex );
+		if ( victim->start < victim->end )
+		{
+			job = victim->start++;
+		}
+		pthread_mutex_unlock( &victim->mutex );
+		if ( job >= 0 )
+		{
+			return job;
+		}
+	}
+	return -1;
+}
+
+/** The main function of the worker threads. */
+static void* pool_worker_main( void *data )
+{
+	struct tempered_pool_worker *worker = (struct tempered_pool_worker *) data;
+	struct tempered_pool_ *pool = worker->pool;
+	unsigned int generation = 0;
+	for ( ;; )
+	{
+		pthread_mutex_lock( &pool->mutex );
+		while ( pool->generation == generation && !pool->shutdown )
+		{
+			pthread_cond_wait( &pool->work_cond, &pool->mutex );
+		}
+		generation = pool->generation;
+		bool shutdown = pool->shutdown;
+		pthread_mutex_unlock( &pool->mutex );
+		if ( shutdown )
+		{
+			return NULL;
+		}
+		int job;
+		while (
+			( job = pool_take( worker ) ) >= 0 ||
+			( job = pool_steal( worker ) ) >= 0
+		) {
+			tempered_device *device = pool->devices[job];
+			bool success = tempered_read_sensors( device );
+			if ( pool->callback != NULL )
+			{
+				pool->callback( device, success, pool->user_data );
+			}
+			pthread_mutex_lock( &pool->mutex );
+			if ( success )
+			{
+				pool->succeeded++;
+			}
+			if ( --pool->remaining == 0 )
+			{
+				pthread_cond_signal( &pool->done_cond );
+			}
+			pthread_mutex_unlock( &pool->mutex );
+		}
+	}
+}
+
+/** Stop and join the first count worker threads, and free the pool. */
+static void pool_free( tempered_pool *pool, int count )
+{
+	pthread_mutex_lock( &pool->mutex );
+	pool->shutdown = true;
+	pthread_cond_broadcast( &pool->work_cond );
+	pthread_mutex_unlock( &pool->mutex );
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		pthread_join( pool->workers[i].thread, NULL );
+	}
+	for ( i = 0; i < pool->thread_count; i++ )
+	{
+		pthread_mutex_destroy( &pool->workers[i].mutex );
+	}
+	pthread_cond_destroy( &pool->done_cond );
+	pthread_cond_destroy( &pool->work_cond );
+	pthread_mutex_destroy( &pool->mutex );
+	pthread_mutex_destroy( &pool->read_mutex );
+	free( pool->workers );
+	free( pool );
+}
+
+#endif
+
+/** Create a pool of worker threads for reading devices in parallel. */
+tempered_pool* tempered_pool_create( int threads, char **error )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( threads <= 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "The pool must have at least one thread." );
+		}
+		return NULL;
+	}
+	tempered_pool *pool = malloc( sizeof( tempered_pool ) );
+	if ( pool != NULL )
+	{
+		pool->workers = calloc( threads, sizeof( struct tempered_pool_worker ) );
+		if ( pool->workers == NULL )
+		{
+			free( pool );
+			pool = NULL;
+		}
+	}
+	if ( pool == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not allocate memory for the pool." );
+		}
+		return NULL;
+	}
+	pool->thread_count = threads;
+	pool->generation = 0;
+	pool->shutdown = false;
+	pool->remaining = 0;
+	pool->succeeded = 0;
+	pool->devices = NULL;
+	pool->callback = NULL;
+	pool->user_data = NULL;
+	pthread_mutex_init( &pool->read_mutex, NULL );
+	pthread_mutex_init( &pool->mutex, NULL );
+	pthread_cond_init( &pool->work_cond, NULL );
+	pthread_cond_init( &pool->done_cond, NULL );
+	int i;
+	for ( i = 0; i < threads; i++ )
+	{
+		pool->workers[i].pool = pool;
+		pool->workers[i].start = 0;
+		pool->workers[i].end = 0;
+		pthread_mutex_init( &pool->workers[i].mutex, NULL );
+	}
+	for ( i = 0; i < threads; i++ )
+	{
+		if (
+			pthread_create(
+				&pool->workers[i].thread, NULL,
+				pool_worker_main, &pool->workers[i]
+			) != 0
+		) {
+			pool_free( pool, i );
+			if ( error != NULL )
+			{
+				*error = strdup( "Could not start the pool's threads." );
+			}
+			return NULL;
+		}
+	}
+	return pool;
+#else
+	(void) threads;
+	if ( error != NULL )
+	{
+		*error = strdup( "Thread pools are not supported on this platform." );
+	}
+	return NULL;
+#endif
+}
+
+/** Stop the threads of a pool and free it. */
+void tempered_pool_destroy( tempered_pool *pool )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( pool != NULL )
+	{
+		pool_free( pool, pool->thread_count );
+	}
+#else
+	(void) pool;
+#endif
+}
+
+/** Read the sensors of the given devices using the threads of the pool. */
+int tempered_pool_read(
+	tempered_pool *pool, tempered_device **devices, int count,
+	tempered_pool_callback callback, void *user_data
+) {
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( pool == NULL || devices == NULL || count <= 0 )
+	{
+		return 0;
+	}
+	pthread_mutex_lock( &pool->read_mutex );
+	pthread_mutex_lock( &pool->mutex );
+	pool->devices = devices;
+	pool->callback = callback;
+	pool->user_data = user_data;
+	pool->remaining = count;
+	pool->succeeded = 0;
+	// Shard the devices evenly over the workers.
+	int i, start = 0;
+	for ( i = 0; i < pool->thread_count; i++ )
+	{
+		struct tempered_pool_worker *worker = &pool->workers[i];
+		int end = start + count / pool->thread_count
+			+ ( i < count % pool->thread_count ? 1 : 0 );
+		pthread_mutex_lock( &worker->mutex );
+		worker->start = start;
+		worker->end = end;
+		pthread_mutex_unlock( &worker->mutex );
+		start = end;
+	}
+	pool->generation++;
+	pthread_cond_broadcast( &pool->work_cond );
+	while ( pool->remaining > 0 )
+	{
+		pthread_cond_wait( &pool->done_cond, &pool->mutex );
+	}
+	int succeeded = pool->succeeded;
+	pool->devices = NULL;
+	pthread_mutex_unlock( &pool->mutex );
+	pthread_mutex_unlock( &pool->read_mutex );
+	return succeeded;
+#else
+	(void) pool;
+	(void) devices;
+	(void) count;
+	(void) callback;
+	(void) user_data;
+	return 0;
+#endif
+}
@@ -0,0 +1,364 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+#include "temper_type.h"
+
+/** The start of a cache file, which includes the format version. */
+#define READ_CACHE_MAGIC "tempered-read-cache 1"
+
+/** The longest cache directory name that can be used. */
+#define READ_CACHE_DIRECTORY_MAX 1024
+
+/** The size of the buffer for the path of a cache file. */
+#define READ_CACHE_PATH_MAX \
+	( READ_CACHE_DIRECTORY_MAX + TEMPERED_LOCATION_MAX + 32 )
+
+/** The largest number of reports that a device can share through the cache. */
+#define READ_CACHE_REPORTS_MAX 8
+
+/** The header at the start of a cache file, which is followed by the reports
+ * of the device and then the times they were read at. The file is only shared
+ * by processes on the same machine, so it is in the native layout.
+ */
+struct read_cache_header
+{
+	/** READ_CACHE_MAGIC, padded with NULs. */
+	char magic[32];
+	
+	/** The location of the device the values were read from. */
+	char location[TEMPERED_LOCATION_MAX];
+	
+	/** The USB vendor ID of that device. */
+	unsigned short vendor_id;
+	
+	/** The USB product ID of that device. */
+	unsigned short product_id;
+	
+	/** The USB interface number of that device. */
+	int interface_number;
+	
+	/** The ID of the subtype of that device. */
+	int subtype_id;
+	
+	/** The number of reports that follow the header. */
+	int report_count;
+	
+	/** The number of read times that follow the reports. */
+	int time_count;
+	
+	/** The sequence number of the values, which is increased each time new
+	 * values are stored.
+	 */
+	unsigned int sequence;
+	
+	/** The CLOCK_REALTIME time (in ns) at which the values were stored.
+	 * This is not the monotonic clock, so that a file that is left over from
+	 * before a reboot is not mistaken for a recent one.
+	 */
+	long long stored;
+};
+
+/** The directory that holds the cache files, or "" if sharing is disabled. */
+static char read_cache_directory[READ_CACHE_DIRECTORY_MAX] = "";
+
+/** Whether the cache directory has been set, either by the program or from
+ * the environment.
+ */
+static bool read_cache_configured = false;
+
+#ifdef TEMPERED_HAVE_PTHREADS
+/** Guards the two variables above, since devices may be read by several
+ * threads at once.
+ */
+static pthread_mutex_t read_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** Lock the cache configuration. */
+static void read_cache_lock( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_lock( &read_cache_mutex );
+#endif
+}
+
+/** Unlock the cache configuration. */
+static void read_cache_unlock( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_unlock( &read_cache_mutex );
+#endif
+}
+
+/** Set the cache directory; the configuration must be locked.
+ * @return false if the directory name is too long.
+ */
+static bool read_cache_set_directory( char const *directory )
+{
+	if ( directory == NULL )
+	{
+		directory = "";
+	}
+	if ( strlen( directory ) >= READ_CACHE_DIRECTORY_MAX )
+	{
+		return false;
+	}
+	strcpy( read_cache_directory, directory );
+	read_cache_configured = true;
+	return true;
+}
+
+/** Set the directory that the sensor values are shared between processes in. */
+bool tempered_set_read_cache( char const *directory, char **error )
+{
+	read_cache_lock();
+	bool result = read_cache_set_directory( directory );
+	read_cache_unlock();
+	if ( !result && error != NULL )
+	{
+		*error = strdup( "The read cache directory name is too long." );
+	}
+	return result;
+}
+
+/** Get the directory that the cache files are in.
+ * If no directory has been set, the TEMPERED_READ_CACHE environment variable
+ * is used.
+ * @param directory The buffer to copy the directory into, which must have room
+ * for READ_CACHE_DIRECTORY_MAX characters.
+ * @return false if sharing is disabled.
+ */
+static bool read_cache_get_directory( char *directory )
+{
+	read_cache_lock();
+	if (
+		!read_cache_configured &&
+		!read_cache_set_directory( getenv( "TEMPERED_READ_CACHE" ) )
+	) {
+		read_cache_set_directory( NULL );
+	}
+	strcpy( directory, read_cache_directory );
+	read_cache_unlock();
+	return directory[0] != '\0';
+}
+
+/** Open and lock the cache file of the given device, and fill in the header
+ * that the file must have to hold values of this device.
+ * The lock is held until the file is closed, so the processes that want to
+ * read the device while another one is reading it wait for it to finish.
+ * @return The file descriptor, or -1 if the values of this device cannot be
+ * shared.
+ */
+static int read_cache_open(
+	tempered_device *device, struct read_cache_header *header,
+	int report_count, int time_count
+) {
+	char directory[READ_CACHE_DIRECTORY_MAX];
+	char name[TEMPERED_LOCATION_MAX];
+	memset( header, 0, sizeof( *header ) );
+	if (
+		report_count > READ_CACHE_REPORTS_MAX ||
+		!read_cache_get_directory( directory ) ||
+		!tempered_get_location_name( device, header->location, name )
+	) {
+		return -1;
+	}
+	strcpy( header->magic, READ_CACHE_MAGIC );
+	header->vendor_id = device->type->vendor_id;
+	header->product_id = device->type->product_id;
+	header->interface_number = device->type->interface_number;
+	header->subtype_id = device->subtype->id;
+	header->report_count = report_count;
+	header->time_count = time_count;
+	char path[READ_CACHE_PATH_MAX];
+	snprintf( path, sizeof( path ), "%s/%s.reports", directory, name );
+	// The file is readable and writable by everyone the umask allows, since
+	// the processes that share a device may well run as different users.
+	// Since the directory may be shared with them as well, a symlink or
+	// anything other than a regular file that was put there is not used.
+	int fd = open( path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0666 );
+	if ( fd < 0 )
+	{
+		return -1;
+	}
+	struct stat info;
+	if ( fstat( fd, &info ) != 0 || !S_ISREG( info.st_mode ) )
+	{
+		close( fd );
+		return -1;
+	}
+	int result;
+	do
+	{
+		result = flock( fd, LOCK_EX );
+	}
+	while ( result != 0 && errno == EINTR );
+	if ( result != 0 )
+	{
+		close( fd );
+		return -1;
+	}
+	return fd;
+}
+
+/** Read the header of an open cache file, and check that it was stored for
+ * the device that the given header is for.
+ * The location is compared as well as the device type, since different
+ * locations can map to one file name.
+ * @return Whether or not the file holds values of that device.
+ */
+static bool read_cache_load_header(
+	int fd, struct read_cache_header const *expected,
+	struct read_cache_header *header
+) {
+	return (
+		pread( fd, header, sizeof( *header ), 0 ) == sizeof( *header ) &&
+		memcmp(
+			header->magic, expected->magic, sizeof( header->magic )
+		) == 0 &&
+		memcmp(
+			header->location, expected->location, sizeof( header->location )
+		) == 0 &&
+		header->vendor_id == expected->vendor_id &&
+		header->product_id == expected->product_id &&
+		header->interface_number == expected->interface_number &&
+		header->subtype_id == expected->subtype_id &&
+		header->report_count == expected->report_count &&
+		header->time_count == expected->time_count
+	);
+}
+
+/** Read the reports and read times from an open cache file whose header has
+ * been checked, into the given arrays of the device.
+ * They are read into temporary arrays first, so that the device keeps its own
+ * values if the file turns out to be short.
+ * @return Whether or not the values were read.
+ */
+static bool read_cache_load_data(
+	int fd, struct tempered_report *reports, int report_count,
+	struct tempered_reading_time *times, int time_count
+) {
+	struct tempered_report stored_reports[READ_CACHE_REPORTS_MAX];
+	struct tempered_reading_time stored_times[READ_CACHE_REPORTS_MAX];
+	size_t reports_size = report_count * sizeof( struct tempered_report );
+	size_t times_size = time_count * sizeof( struct tempered_reading_time );
+	off_t offset = sizeof( struct read_cache_header );
+	if (
+		pread( fd, stored_reports, reports_size, offset ) !=
+			(ssize_t) reports_size ||
+		pread( fd, stored_times, times_size, offset + reports_size ) !=
+			(ssize_t) times_size
+	) {
+		return false;
+	}
+	memcpy( reports, stored_reports, reports_size );
+	memcpy( times, stored_times, times_size );
+	return true;
+}
+
+/** Write the given header, reports and read times to an open cache file.
+ * The data is written before the header, so that a reader that does not lock
+ * the file (or a process that dies halfway) never pairs a new header with old
+ * data. Errors are ignored, other than not counting the values as stored.
+ * @return Whether or not everything was written.
+ */
+static bool read_cache_store(
+	int fd, struct read_cache_header const *header,
+	struct tempered_report const *reports, int report_count,
+	struct tempered_reading_time const *times, int time_count
+) {
+	size_t reports_size = report_count * sizeof( struct tempered_report );
+	size_t times_size = time_count * sizeof( struct tempered_reading_time );
+	off_t offset = sizeof( struct read_cache_header );
+	return (
+		pwrite( fd, reports, reports_size, offset ) ==
+			(ssize_t) reports_size &&
+		pwrite( fd, times, times_size, offset + reports_size ) ==
+			(ssize_t) times_size &&
+		pwrite( fd, header, sizeof( *header ), 0 ) == sizeof( *header )
+	);
+}
+
+/** Make sure the sensor values of the given device are recent enough. */
+bool tempered_read_cache_read( tempered_device *device, long long max_age )
+{
+	int report_count = 0;
+	int time_count = 0;
+	struct tempered_report *reports = NULL;
+	struct tempered_reading_time *times = NULL;
+	if ( device->type->get_reports != NULL )
+	{
+		reports = device->type->get_reports( device, &report_count );
+	}
+	if ( reports != NULL && device->type->get_report_times != NULL )
+	{
+		times = device->type->get_report_times( device, &time_count );
+		if ( times == NULL || time_count != report_count )
+		{
+			times = NULL;
+			time_count = 0;
+		}
+	}
+	struct read_cache_header header;
+	int fd = -1;
+	if ( reports != NULL )
+	{
+		fd = read_cache_open( device, &header, report_count, time_count );
+	}
+	if ( fd < 0 )
+	{
+		return tempered_read_sensors( device );
+	}
+	struct read_cache_header stored;
+	bool valid = read_cache_load_header( fd, &header, &stored );
+	if ( valid )
+	{
+		long long age = tempered_realtime_ns() - stored.stored;
+		if (
+			age >= 0 && age <= max_age &&
+			read_cache_load_data(
+				fd, reports, report_count, times, time_count
+			)
+		) {
+			close( fd );
+			device->read_time = tempered_monotonic_ns() - age;
+			if ( stored.sequence != device->shared_sequence )
+			{
+				device->sequence++;
+				device->shared_sequence = stored.sequence;
+			}
+			return true;
+		}
+	}
+	bool result = tempered_read_sensors( device );
+	if ( result )
+	{
+		header.sequence = ( valid ? stored.sequence + 1 : 1 );
+		if ( header.sequence == 0 )
+		{
+			header.sequence = 1;
+		}
+		header.stored = tempered_realtime_ns();
+		if (
+			read_cache_store(
+				fd, &header, reports, report_count, times, time_count
+			)
+		) {
+			device->shared_sequence = header.sequence;
+		}
+	}
+	close( fd );
+	return result;
+}
@@ -0,0 +1,483 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+/** The largest number of samples that a sampler's buffer can have room for. */
+#define SAMPLER_CAPACITY_MAX ( 1 << 20 )
+
+#ifdef TEMPERED_HAVE_PTHREADS
+
+#if defined( _POSIX_CLOCK_SELECTION ) && _POSIX_CLOCK_SELECTION >= 0
+/** Defined if the sampler threads can wait until a CLOCK_MONOTONIC time, which
+ * is not affected by changes to the system clock. Otherwise they wait until
+ * the matching CLOCK_REALTIME time.
+ */
+#define SAMPLER_MONOTONIC_WAIT
+#endif
+
+/** This is the actual struct the tempered_sampler opaque type is built from.
+ *
+ * The samples are passed from the sampler's thread to the consumer through a
+ * ring buffer with a single producer and a single consumer. Each side only
+ * writes its own index (the thread writes tail, the consumer writes head), and
+ * publishes it with a release store after it is done with the samples, so the
+ * two never have to wait for each other.
+ */
+struct tempered_sampler_
+{
+	/** The device that is read. */
+	tempered_device *device;
+	
+	/** The time between the starts of the reads, in nanoseconds. */
+	long long interval;
+	
+	/** The thread that reads the device. */
+	pthread_t thread;
+	
+	/** The file descriptor that becomes readable when samples are stored.
+	 * This is an eventfd, or the read end of a pipe where there is none.
+	 */
+	int fd;
+	
+	/** The file descriptor that is written to signal fd, which is the same
+	 * as fd for an eventfd, or the write end of the pipe.
+	 */
+	int signal_fd;
+	
+	/** The ring buffer of capacity samples. */
+	struct tempered_sample *samples;
+	
+	/** The number of samples in the ring buffer, which is a power of two. */
+	unsigned int capacity;
+	
+	/** The number of samples the consumer has taken, which wraps around. */
+	unsigned int head;
+	
+	/** The number of samples the thread has stored, which wraps around. */
+	unsigned int tail;
+	
+	/** The number of reads that were not done because the buffer was full. */
+	unsigned int full;
+	
+	/** The number of reads that were skipped because they were due while the
+	 * read before them was still going on.
+	 */
+	unsigned int late;
+	
+	/** The mutex that guards stopping. */
+	pthread_mutex_t mutex;
+	
+	/** Signalled when the sampler is being stopped. This uses CLOCK_MONOTONIC
+	 * (where it can), so that the thread can wait on it until the next read is
+	 * due.
+	 */
+	pthread_cond_t cond;
+	
+	/** Whether the sampler is being stopped. */
+	bool stopping;
+};
+
+/** Create the file descriptors that the consumer waits on.
+ * @return Whether or not they were created.
+ */
+static bool sampler_open_fds( tempered_sampler *sampler )
+{
+#ifdef __linux__
+	sampler->fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+	sampler->signal_fd = sampler->fd;
+	return sampler->fd >= 0;
+#else
+	int fds[2];
+	if ( pipe( fds ) != 0 )
+	{
+		return false;
+	}
+	int i;
+	for ( i = 0; i < 2; i++ )
+	{
+		fcntl( fds[i], F_SETFL, fcntl( fds[i], F_GETFL ) | O_NONBLOCK );
+		fcntl( fds[i], F_SETFD, FD_CLOEXEC );
+	}
+	sampler->fd = fds[0];
+	sampler->signal_fd = fds[1];
+	return true;
+#endif
+}
+
+/** Close the file descriptors that the consumer waits on. */
+static void sampler_close_fds( tempered_sampler *sampler )
+{
+	if ( sampler->signal_fd != sampler->fd )
+	{
+		close( sampler->signal_fd );
+	}
+	close( sampler->fd );
+}
+
+/** Signal the sampler's file descriptor, so that the consumer wakes up. */
+static void sampler_signal( tempered_sampler *sampler )
+{
+	// A full pipe is readable already, so failing with EAGAIN is fine.
+	uint64_t one = 1;
+	size_t size = ( sampler->signal_fd == sampler->fd ? sizeof( one ) : 1 );
+	ssize_t result;
+	do
+	{
+		result = write( sampler->signal_fd, &one, size );
+	}
+	while ( result < 0 && errno == EINTR );
+}
+
+/** Clear the sampler's file descriptor, so that it is not readable until it is
+ * signalled again.
+ */
+static void sampler_clear( tempered_sampler *sampler )
+{
+	// An eventfd is cleared by a single read, a pipe by emptying it.
+	bool is_pipe = ( sampler->signal_fd != sampler->fd );
+	uint64_t signalled[8];
+	size_t size = ( is_pipe ? sizeof( signalled ) : sizeof( signalled[0] ) );
+	ssize_t result;
+	do
+	{
+		result = read( sampler->fd, signalled, size );
+	}
+	while ( ( result < 0 && errno == EINTR ) || ( is_pipe && result > 0 ) );
+}
+
+/** Convert a CLOCK_MONOTONIC time in nanoseconds to the deadline to wait on
+ * the sampler's condition variable until.
+ */
+static struct timespec sampler_deadline( long long time )
+{
+#ifndef SAMPLER_MONOTONIC_WAIT
+	time += tempered_realtime_ns() - tempered_monotonic_ns();
+#endif
+	struct timespec deadline = {
+		.tv_sec = time / 1000000000LL,
+		.tv_nsec = time % 1000000000LL
+	};
+	return deadline;
+}
+
+/** Read the device, and store the values in the next sample of the buffer,
+ * unless the buffer is full.
+ * @param scheduled The time the read was due, for the sample.
+ */
+static void sampler_take( tempered_sampler *sampler, long long scheduled )
+{
+	unsigned int head = __atomic_load_n( &sampler->head, __ATOMIC_ACQUIRE );
+	if ( sampler->tail - head >= sampler->capacity )
+	{
+		__atomic_fetch_add( &sampler->full, 1, __ATOMIC_RELAXED );
+		return;
+	}
+	struct tempered_sample *sample =
+		&sampler->samples[sampler->tail & ( sampler->capacity - 1 )];
+	tempered_device *device = sampler->device;
+	sample->scheduled = scheduled;
+	sample->error = TEMPERED_ERROR_NONE;
+	sample->count = 0;
+	tempered_lock( device );
+	if ( tempered_read_sensors( device ) )
+	{
+		sample->count = tempered_get_readings(
+			device, sample->readings, TEMPERED_SAMPLE_MAX_SENSORS
+		);
+	}
+	if ( sample->count <= 0 )
+	{
+		sample->count = 0;
+		sample->error = tempered_errno( device );
+	}
+	sample->sequence = device->sequence;
+	tempered_unlock( device );
+	sample->completed = tempered_monotonic_ns();
+	__atomic_store_n( &sampler->tail, sampler->tail + 1, __ATOMIC_RELEASE );
+	sampler_signal( sampler );
+}
+
+/** The main function of the sampler threads. */
+static void* sampler_main( void *data )
+{
+	tempered_sampler *sampler = (tempered_sampler *) data;
+	long long interval = sampler->interval;
+	long long next = tempered_monotonic_ns();
+	pthread_mutex_lock( &sampler->mutex );
+	while ( !sampler->stopping )
+	{
+		pthread_mutex_unlock( &sampler->mutex );
+		sampler_take( sampler, next );
+		next += interval;
+		long long now = tempered_monotonic_ns();
+		if ( now > next )
+		{
+			// Skip ahead to the first read that is not due yet, so the reads
+			// stay on the same schedule instead of bunching up.
+			long long missed = ( now - next + interval - 1 ) / interval;
+			next += missed * interval;
+			__atomic_fetch_add( &sampler->late, missed, __ATOMIC_RELAXED );
+		}
+		struct timespec deadline = sampler_deadline( next );
+		pthread_mutex_lock( &sampler->mutex );
+		while (
+			!sampler->stopping &&
+			pthread_cond_timedwait(
+				&sampler->cond, &sampler->mutex, &deadline
+			) != ETIMEDOUT
+		) {
+			// Woken up early (or spuriously); wait for the rest of the time.
+		}
+	}
+	pthread_mutex_unlock( &sampler->mutex );
+	return NULL;
+}
+
+/** Free a sampler whose thread is not running, and its resources. */
+static void sampler_free( tempered_sampler *sampler )
+{
+	pthread_cond_destroy( &sampler->cond );
+	pthread_mutex_destroy( &sampler->mutex );
+	sampler_close_fds( sampler );
+	free( sampler->samples );
+	free( sampler );
+}
+
+/** Create the condition variable of a sampler, which uses CLOCK_MONOTONIC
+ * where it can.
+ * @return Whether or not it was created.
+ */
+static bool sampler_init_cond( tempered_sampler *sampler )
+{
+#ifndef SAMPLER_MONOTONIC_WAIT
+	return pthread_cond_init( &sampler->cond, NULL ) == 0;
+#else
+	pthread_condattr_t attr;
+	if ( pthread_condattr_init( &attr ) != 0 )
+	{
+		return false;
+	}
+	bool result = (
+		pthread_condattr_setclock( &attr, CLOCK_MONOTONIC ) == 0 &&
+		pthread_cond_init( &sampler->cond, &attr ) == 0
+	);
+	pthread_condattr_destroy( &attr );
+	return result;
+#endif
+}
+
+#endif
+
+/** Start a thread that reads the sensors of a device at a fixed interval. */
+tempered_sampler* tempered_sampler_start(
+	tempered_device *device, int interval_ms, int capacity, char **error
+) {
+#ifdef TEMPERED_HAVE_PTHREADS
+	char const *message = NULL;
+	if ( device == NULL )
+	{
+		message = "Invalid device given.";
+	}
+	else if ( interval_ms <= 0 )
+	{
+		message = "The sampling interval must be positive.";
+	}
+	else if ( capacity <= 0 || capacity > SAMPLER_CAPACITY_MAX )
+	{
+		message = "The sample buffer size is out of range.";
+	}
+	if ( message != NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( message );
+		}
+		return NULL;
+	}
+	unsigned int size = 1;
+	while ( size < (unsigned int) capacity )
+	{
+		size <<= 1;
+	}
+	tempered_sampler *sampler = malloc( sizeof( tempered_sampler ) );
+	if ( sampler != NULL )
+	{
+		sampler->samples = calloc( size, sizeof( struct tempered_sample ) );
+		if ( sampler->samples == NULL )
+		{
+			free( sampler );
+			sampler = NULL;
+		}
+	}
+	if ( sampler == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not allocate memory for the sampler." );
+		}
+		return NULL;
+	}
+	sampler->device = device;
+	sampler->interval = interval_ms * 1000000LL;
+	sampler->capacity = size;
+	sampler->head = 0;
+	sampler->tail = 0;
+	sampler->full = 0;
+	sampler->late = 0;
+	sampler->stopping = false;
+	if ( !sampler_open_fds( sampler ) )
+	{
+		free( sampler->samples );
+		free( sampler );
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not create the sampler's wakeup fd." );
+		}
+		return NULL;
+	}
+	if ( !sampler_init_cond( sampler ) )
+	{
+		sampler_close_fds( sampler );
+		free( sampler->samples );
+		free( sampler );
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not create the sampler's timer." );
+		}
+		return NULL;
+	}
+	pthread_mutex_init( &sampler->mutex, NULL );
+	if ( pthread_create( &sampler->thread, NULL, sampler_main, sampler ) != 0 )
+	{
+		sampler_free( sampler );
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not start the sampler's thread." );
+		}
+		return NULL;
+	}
+	return sampler;
+#else
+	(void) device;
+	(void) interval_ms;
+	(void) capacity;
+	if ( error != NULL )
+	{
+		*error = strdup( "Samplers are not supported on this platform." );
+	}
+	return NULL;
+#endif
+}
+
+/** Stop the thread of a sampler and free it. */
+void tempered_sampler_stop( tempered_sampler *sampler )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( sampler == NULL )
+	{
+		return;
+	}
+	pthread_mutex_lock( &sampler->mutex );
+	sampler->stopping = true;
+	pthread_cond_signal( &sampler->cond );
+	pthread_mutex_unlock( &sampler->mutex );
+	pthread_join( sampler->thread, NULL );
+	sampler_free( sampler );
+#else
+	(void) sampler;
+#endif
+}
+
+/** Get the file descriptor that becomes readable when there are samples. */
+int tempered_sampler_get_fd( tempered_sampler *sampler )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( sampler == NULL )
+	{
+		return -1;
+	}
+	return sampler->fd;
+#else
+	(void) sampler;
+	return -1;
+#endif
+}
+
+/** Take the oldest samples that a sampler has stored. */
+int tempered_sampler_pop_batch(
+	tempered_sampler *sampler, struct tempered_sample *samples, int max
+) {
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( sampler == NULL || samples == NULL || max < 0 )
+	{
+		return -1;
+	}
+	// Clear the fd before looking at the buffer, so that a sample that is
+	// stored after this is signalled again rather than missed.
+	sampler_clear( sampler );
+	unsigned int head = sampler->head;
+	unsigned int tail = __atomic_load_n( &sampler->tail, __ATOMIC_ACQUIRE );
+	unsigned int count = tail - head;
+	if ( count > (unsigned int) max )
+	{
+		count = max;
+	}
+	unsigned int i;
+	for ( i = 0; i < count; i++ )
+	{
+		samples[i] = sampler->samples[( head + i ) & ( sampler->capacity - 1 )];
+	}
+	__atomic_store_n( &sampler->head, head + count, __ATOMIC_RELEASE );
+	if ( head + count != tail )
+	{
+		// Some samples did not fit, so make sure the consumer comes back.
+		sampler_signal( sampler );
+	}
+	return count;
+#else
+	(void) sampler;
+	(void) samples;
+	(void) max;
+	return -1;
+#endif
+}
+
+/** Get the number of samples that a sampler did not take. */
+bool tempered_sampler_get_missed(
+	tempered_sampler *sampler, unsigned int *full, unsigned int *late
+) {
+#ifdef TEMPERED_HAVE_PTHREADS
+	if ( sampler == NULL )
+	{
+		return false;
+	}
+	if ( full != NULL )
+	{
+		*full = __atomic_load_n( &sampler->full, __ATOMIC_RELAXED );
+	}
+	if ( late != NULL )
+	{
+		*late = __atomic_load_n( &sampler->late, __ATOMIC_RELAXED );
+	}
+	return true;
+#else
+	(void) sampler;
+	(void) full;
+	(void) late;
+	return false;
+#endif
+}
@@ -0,0 +1,284 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+#include "temper_type.h"
+
+/** The first line of a cache file, which includes the format version. */
+#define SUBTYPE_CACHE_MAGIC "tempered-subtype-cache 1"
+
+/** The longest cache directory name that can be used. */
+#define SUBTYPE_CACHE_DIRECTORY_MAX 1024
+
+/** The longest device location that is cached. */
+#define SUBTYPE_CACHE_LOCATION_MAX TEMPERED_LOCATION_MAX
+
+/** The largest cache file that is read. */
+#define SUBTYPE_CACHE_FILE_MAX ( SUBTYPE_CACHE_LOCATION_MAX + 64 )
+
+/** The size of the buffer for the path of a cache file. */
+#define SUBTYPE_CACHE_PATH_MAX \
+	( SUBTYPE_CACHE_DIRECTORY_MAX + SUBTYPE_CACHE_LOCATION_MAX + 32 )
+
+/** The directory that holds the cache files, or "" if caching is disabled. */
+static char subtype_cache_directory[SUBTYPE_CACHE_DIRECTORY_MAX] = "";
+
+/** Whether the cache directory has been set, either by the program or from
+ * the environment.
+ */
+static bool subtype_cache_configured = false;
+
+/** The number of times a subtype has been stored by this process, which makes
+ * the names of the temporary files unique.
+ */
+static unsigned int subtype_cache_stores = 0;
+
+#ifdef TEMPERED_HAVE_PTHREADS
+/** Guards the two variables above, since devices may be opened by several
+ * threads at once.
+ */
+static pthread_mutex_t subtype_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** Lock the cache configuration. */
+static void subtype_cache_lock( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_lock( &subtype_cache_mutex );
+#endif
+}
+
+/** Unlock the cache configuration. */
+static void subtype_cache_unlock( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_unlock( &subtype_cache_mutex );
+#endif
+}
+
+/** Set the cache directory; the configuration must be locked.
+ * @return false if the directory name is too long.
+ */
+static bool subtype_cache_set_directory( char const *directory )
+{
+	if ( directory == NULL )
+	{
+		directory = "";
+	}
+	if ( strlen( directory ) >= SUBTYPE_CACHE_DIRECTORY_MAX )
+	{
+		return false;
+	}
+	strcpy( subtype_cache_directory, directory );
+	subtype_cache_configured = true;
+	return true;
+}
+
+/** Set the directory that the detected device subtypes are cached in. */
+bool tempered_set_subtype_cache( char const *directory, char **error )
+{
+	subtype_cache_lock();
+	bool result = subtype_cache_set_directory( directory );
+	subtype_cache_unlock();
+	if ( !result && error != NULL )
+	{
+		*error = strdup( "The subtype cache directory name is too long." );
+	}
+	return result;
+}
+
+/** Get the directory that the cache files are in.
+ * If no directory has been set, the TEMPERED_SUBTYPE_CACHE environment
+ * variable is used.
+ * @param directory The buffer to copy the directory into, which must have room
+ * for SUBTYPE_CACHE_DIRECTORY_MAX characters.
+ * @return false if caching is disabled.
+ */
+static bool subtype_cache_get_directory( char *directory )
+{
+	subtype_cache_lock();
+	if (
+		!subtype_cache_configured &&
+		!subtype_cache_set_directory( getenv( "TEMPERED_SUBTYPE_CACHE" ) )
+	) {
+		subtype_cache_set_directory( NULL );
+	}
+	strcpy( directory, subtype_cache_directory );
+	subtype_cache_unlock();
+	return directory[0] != '\0';
+}
+
+/** Get the location of the given device, and a file name for it. */
+bool tempered_get_location_name(
+	tempered_device *device, char *location, char *name
+) {
+	if (
+		device->type->get_location == NULL ||
+		!device->type->get_location( device, location, TEMPERED_LOCATION_MAX )
+	) {
+		int length = snprintf(
+			location, TEMPERED_LOCATION_MAX, "%s", device->path
+		);
+		if ( length < 0 || length >= TEMPERED_LOCATION_MAX )
+		{
+			return false;
+		}
+	}
+	if ( location[0] == '\0' || strchr( location, '\n' ) != NULL )
+	{
+		return false;
+	}
+	int i;
+	for ( i = 0; location[i] != '\0'; i++ )
+	{
+		char c = location[i];
+		name[i] = ( isalnum( (unsigned char) c ) || c == '-' ? c : '_' );
+	}
+	name[i] = '\0';
+	return true;
+}
+
+/** Get the location of the given device, and the path of its cache file.
+ * @return false if the subtype of this device should not be cached.
+ */
+static bool subtype_cache_get_path(
+	tempered_device *device, char *location, char *path
+) {
+	char directory[SUBTYPE_CACHE_DIRECTORY_MAX];
+	char name[SUBTYPE_CACHE_LOCATION_MAX];
+	if (
+		device->type->get_subtype_id == NULL ||
+		!subtype_cache_get_directory( directory ) ||
+		!tempered_get_location_name( device, location, name )
+	) {
+		return false;
+	}
+	// The location itself is stored in the file and checked when it is read,
+	// so it does not matter that different locations can map to one name.
+	snprintf(
+		path, SUBTYPE_CACHE_PATH_MAX, "%s/%s.subtype", directory, name
+	);
+	return true;
+}
+
+/** Format the contents of the cache file for the given device, without the
+ * subtype ID at the end.
+ * @return The length of the contents, or -1 if they did not fit.
+ */
+static int subtype_cache_format(
+	tempered_device *device, char const *location, char *data
+) {
+	int length = snprintf(
+		data, SUBTYPE_CACHE_FILE_MAX, "%s\n%s\n%04x:%04x:%d ",
+		SUBTYPE_CACHE_MAGIC, location, device->type->vendor_id,
+		device->type->product_id, device->type->interface_number
+	);
+	if ( length < 0 || length + 4 >= SUBTYPE_CACHE_FILE_MAX )
+	{
+		return -1;
+	}
+	return length;
+}
+
+/** Look up the subtype ID of the given device in the cache. */
+bool tempered_subtype_cache_load(
+	tempered_device *device, unsigned char *subtype_id
+) {
+	char location[SUBTYPE_CACHE_LOCATION_MAX];
+	char path[SUBTYPE_CACHE_PATH_MAX];
+	if ( !subtype_cache_get_path( device, location, path ) )
+	{
+		return false;
+	}
+	char expected[SUBTYPE_CACHE_FILE_MAX];
+	int prefix = subtype_cache_format( device, location, expected );
+	if ( prefix < 0 )
+	{
+		return false;
+	}
+	int fd = open( path, O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+	char data[SUBTYPE_CACHE_FILE_MAX];
+	int length = read( fd, data, sizeof( data ) - 1 );
+	close( fd );
+	if ( length < prefix || memcmp( data, expected, prefix ) != 0 )
+	{
+		// Not a cache file for this device (or of an older format).
+		return false;
+	}
+	data[length] = '\0';
+	unsigned int id;
+	char end;
+	if (
+		sscanf( data + prefix, "%2x%c", &id, &end ) != 2 || end != '\n' ||
+		temper_type_find_subtype( device->type, id ) == NULL
+	) {
+		return false;
+	}
+	*subtype_id = id;
+	return true;
+}
+
+/** Store the subtype ID of the given device in the cache. */
+void tempered_subtype_cache_store(
+	tempered_device *device, unsigned char subtype_id
+) {
+	char location[SUBTYPE_CACHE_LOCATION_MAX];
+	char path[SUBTYPE_CACHE_PATH_MAX];
+	if ( !subtype_cache_get_path( device, location, path ) )
+	{
+		return;
+	}
+	char data[SUBTYPE_CACHE_FILE_MAX];
+	int length = subtype_cache_format( device, location, data );
+	if ( length < 0 )
+	{
+		return;
+	}
+	length += snprintf( data + length, 4, "%02x\n", subtype_id );
+	// The file is written under a temporary name and then renamed, so that
+	// other processes opening devices at the same time never see half of it.
+	// The name is unique to this store, and must not exist yet, so that a
+	// file (or symlink) that someone else put there is never written to.
+	char temp_path[SUBTYPE_CACHE_PATH_MAX + 40];
+	snprintf(
+		temp_path, sizeof( temp_path ), "%s.%ld.%u", path, (long) getpid(),
+		__atomic_fetch_add( &subtype_cache_stores, 1, __ATOMIC_RELAXED )
+	);
+	int fd = open(
+		temp_path, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644
+	);
+	if ( fd < 0 )
+	{
+		return;
+	}
+	bool written = ( write( fd, data, length ) == length );
+	if ( close( fd ) != 0 || !written || rename( temp_path, path ) != 0 )
+	{
+		unlink( temp_path );
+	}
+}
+
+/** Remove the given device from the cache. */
+void tempered_subtype_cache_forget( tempered_device *device )
+{
+	char location[SUBTYPE_CACHE_LOCATION_MAX];
+	char path[SUBTYPE_CACHE_PATH_MAX];
+	if ( subtype_cache_get_path( device, location, path ) )
+	{
+		unlink( path );
+	}
+}
@@ -1,11 +1,15 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "temper_type.h"
 
 #include "tempered.h"
 #include "type_hid/type-info.h"
 #include "type_hid/common.h"
+#include "type_hid/transport.h"
 #include "type_hid/fm75.h"
 #include "type_hid/sht1x.h"
 #include "type_hid/ntc.h"
@@ -26,6 +30,14 @@ struct temper_type known_temper_types[]={
 		.interface_number=1,
 		.open = tempered_type_hid_open,
 		.close = tempered_type_hid_close,
+		.get_pollfd = tempered_type_hid_get_pollfd,
+		.set_uring = tempered_type_hid_set_uring,
+		.get_reports = tempered_type_hid_get_reports,
+		.set_reports = tempered_type_hid_set_reports,
+		.get_report_times = tempered_type_hid_get_report_times,
+		.get_location = tempered_type_hid_get_location,
+		.get_reading_time = tempered_type_hid_get_reading_time,
+		.get_raw = tempered_type_hid_get_raw,
 		.get_subtype_id = tempered_type_hid_get_subtype_id_from_string,
 		.get_subtype_data = &(struct tempered_type_hid_subtype_from_string_data)
 		{
@@ -47,6 +59,9 @@ struct temper_type known_temper_types[]={
 					.name = "TEMPer2HumiV1.x",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_temperature = tempered_type_hid_get_temperature,
 					.get_humidity = tempered_type_hid_get_humidity
 				},
@@ -55,7 +70,9 @@ struct temper_type known_temper_types[]={
 					{
 						.query = {
 							.length = 9,
-							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 }
+							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 },
+							.response_header_length = 1,
+							.response_header = (unsigned char[]){ 0x80 }
 						},
 						.read_sensors = tempered_type_hid_read_sensor_group,
 						.sensor_count = 1,
@@ -66,7 +83,8 @@ struct temper_type known_temper_types[]={
 								.temperature_high_byte_offset = 2,
 								.temperature_low_byte_offset = 3,
 								.humidity_high_byte_offset = 4,
-								.humidity_low_byte_offset = 5
+								.humidity_low_byte_offset = 5,
+								.raw_format = TEMPERED_RAW_FORMAT_SHT1X
 							}
 						}
 					}
@@ -78,6 +96,9 @@ struct temper_type known_temper_types[]={
 					.name = "TEMPerHumM12V1.0",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_temperature = tempered_type_hid_get_temperature,
 					.get_humidity = tempered_type_hid_get_humidity
 				},
@@ -86,7 +107,9 @@ struct temper_type known_temper_types[]={
 					{
 						.query = {
 							.length = 9,
-							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 }
+							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 },
+							.response_header_length = 1,
+							.response_header = (unsigned char[]){ 0x80 }
 						},
 						.read_sensors = tempered_type_hid_read_sensor_group,
 						.sensor_count = 1,
@@ -97,7 +120,8 @@ struct temper_type known_temper_types[]={
 								.temperature_high_byte_offset = 2,
 								.temperature_low_byte_offset = 3,
 								.humidity_high_byte_offset = 4,
-								.humidity_low_byte_offset = 5
+								.humidity_low_byte_offset = 5,
+								.raw_format = TEMPERED_RAW_FORMAT_SI7005
 							}
 						}
 					}
@@ -119,6 +143,14 @@ struct temper_type known_temper_types[]={
 		.interface_number=1,
 		.open = tempered_type_hid_open,
 		.close = tempered_type_hid_close,
+		.get_pollfd = tempered_type_hid_get_pollfd,
+		.set_uring = tempered_type_hid_set_uring,
+		.get_reports = tempered_type_hid_get_reports,
+		.set_reports = tempered_type_hid_set_reports,
+		.get_report_times = tempered_type_hid_get_report_times,
+		.get_location = tempered_type_hid_get_location,
+		.get_reading_time = tempered_type_hid_get_reading_time,
+		.get_raw = tempered_type_hid_get_raw,
 		.get_subtype_id = tempered_type_hid_get_subtype_id,
 		.get_subtype_data =  &(struct tempered_type_hid_subtype_data){
 			.id_offset = 1,
@@ -137,6 +169,9 @@ struct temper_type known_temper_types[]={
 					.name = "TEMPerV1.2",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_temperature = tempered_type_hid_get_temperature,
 				},
 				.sensor_group_count = 1,
@@ -144,7 +179,9 @@ struct temper_type known_temper_types[]={
 					{
 						.query = {
 							.length = 9,
-							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 }
+							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 },
+							.response_header_length = 1,
+							.response_header = (unsigned char[]){ 0x80 }
 						},
 						.read_sensors = tempered_type_hid_read_sensor_group,
 						.sensor_count = 1,
@@ -152,7 +189,8 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 2,
-								.temperature_low_byte_offset = 3
+								.temperature_low_byte_offset = 3,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					}
@@ -164,6 +202,9 @@ struct temper_type known_temper_types[]={
 					.name = "TEMPer2V1.3",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_sensor_count = tempered_type_hid_get_sensor_count,
 					.get_temperature = tempered_type_hid_get_temperature,
 				},
@@ -172,7 +213,9 @@ struct temper_type known_temper_types[]={
 					{
 						.query = {
 							.length = 9,
-							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 }
+							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 },
+							.response_header_length = 1,
+							.response_header = (unsigned char[]){ 0x80 }
 						},
 						.read_sensors = tempered_type_hid_read_sensor_group,
 						.sensor_count = 2,
@@ -180,12 +223,14 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 2,
-								.temperature_low_byte_offset = 3
+								.temperature_low_byte_offset = 3,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							},
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 4,
-								.temperature_low_byte_offset = 5
+								.temperature_low_byte_offset = 5,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					}
@@ -197,6 +242,9 @@ struct temper_type known_temper_types[]={
 					.name = "TEMPerNTC1.0",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_sensor_count = tempered_type_hid_get_sensor_count,
 					.get_temperature = tempered_type_hid_get_temperature,
 				},
@@ -205,7 +253,9 @@ struct temper_type known_temper_types[]={
 					{
 						.query = {
 							.length = 9,
-							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 }
+							.data = (unsigned char[]){ 0, 1, 0x80, 0x33, 1, 0, 0, 0, 0 },
+							.response_header_length = 1,
+							.response_header = (unsigned char[]){ 0x80 }
 						},
 						.read_sensors = tempered_type_hid_read_sensor_group,
 						.sensor_count = 3,
@@ -213,17 +263,20 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 2,
-								.temperature_low_byte_offset = 3
+								.temperature_low_byte_offset = 3,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							},
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 4,
-								.temperature_low_byte_offset = 5
+								.temperature_low_byte_offset = 5,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							},
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 6,
-								.temperature_low_byte_offset = 7
+								.temperature_low_byte_offset = 7,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					}
@@ -245,6 +298,14 @@ struct temper_type known_temper_types[]={
 		.interface_number=1,
 		.open = tempered_type_hid_open,
 		.close = tempered_type_hid_close,
+		.get_pollfd = tempered_type_hid_get_pollfd,
+		.set_uring = tempered_type_hid_set_uring,
+		.get_reports = tempered_type_hid_get_reports,
+		.set_reports = tempered_type_hid_set_reports,
+		.get_report_times = tempered_type_hid_get_report_times,
+		.get_location = tempered_type_hid_get_location,
+		.get_reading_time = tempered_type_hid_get_reading_time,
+		.get_raw = tempered_type_hid_get_raw,
 		.get_subtype_id = tempered_type_hid_get_subtype_id,
 		.get_subtype_data = &(struct tempered_type_hid_subtype_data){
 			.id_offset = 2,
@@ -264,6 +325,9 @@ struct temper_type known_temper_types[]={
 					.open = tempered_type_hid_subtype_open,
 					.name = "HidTEMPer1 (experimental)",
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_temperature = tempered_type_hid_get_temperature
 				},
 				.sensor_group_count = 1,
@@ -279,7 +343,8 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 0,
-								.temperature_low_byte_offset = 1
+								.temperature_low_byte_offset = 1,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					}
@@ -291,6 +356,9 @@ struct temper_type known_temper_types[]={
 					.name = "HidTEMPer2 (experimental)",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_sensor_count = tempered_type_hid_get_sensor_count,
 					.get_temperature = tempered_type_hid_get_temperature
 				},
@@ -307,7 +375,8 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 0,
-								.temperature_low_byte_offset = 1
+								.temperature_low_byte_offset = 1,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					},
@@ -322,7 +391,8 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 0,
-								.temperature_low_byte_offset = 1
+								.temperature_low_byte_offset = 1,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					}
@@ -335,6 +405,9 @@ struct temper_type known_temper_types[]={
 					.name = "HidTEMPerHUM (experimental)",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_temperature = tempered_type_hid_get_temperature,
 					.get_humidity = tempered_type_hid_get_humidity
 				},
@@ -354,7 +427,8 @@ struct temper_type known_temper_types[]={
 								.temperature_high_byte_offset = 0,
 								.temperature_low_byte_offset = 1
 								.humidity_high_byte_offset = 2,
-								.humidity_low_byte_offset = 3
+								.humidity_low_byte_offset = 3,
+								.raw_format = TEMPERED_RAW_FORMAT_SHT1X
 							}
 						}
 					}
@@ -367,6 +441,9 @@ struct temper_type known_temper_types[]={
 					.name = "HidTEMPerNTC (experimental)",
 					.open = tempered_type_hid_subtype_open,
 					.read_sensors = tempered_type_hid_read_sensors,
+					.read_sensors_start = tempered_type_hid_read_sensors_start,
+					.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+					.get_readings = tempered_type_hid_get_readings,
 					.get_sensor_count = tempered_type_hid_get_sensor_count,
 					.get_temperature = tempered_type_hid_get_temperature
 				},
@@ -383,7 +460,8 @@ struct temper_type known_temper_types[]={
 							{
 								.get_temperature = tempered_type_hid_get_temperature_fm75,
 								.temperature_high_byte_offset = 0,
-								.temperature_low_byte_offset = 1
+								.temperature_low_byte_offset = 1,
+								.raw_format = TEMPERED_RAW_FORMAT_FM75
 							}
 						}
 					},
@@ -410,28 +488,227 @@ struct temper_type known_temper_types[]={
 	{ .name=NULL } // List terminator for temper types
 };
 
+/** The number of types in known_temper_types, excluding the terminator. */
+#define TEMPER_TYPE_COUNT \
+	( sizeof( known_temper_types ) / sizeof( known_temper_types[0] ) - 1 )
+
+/** The known types, sorted by vendor ID, product ID and interface number, so
+ * that temper_type_find can do a binary search instead of scanning them all.
+ */
+static struct temper_type *temper_type_index[TEMPER_TYPE_COUNT];
+
+/** For each known type, its subtypes indexed by subtype ID. */
+static struct temper_subtype *temper_subtype_index[TEMPER_TYPE_COUNT][256];
+
+/** The distinct USB vendor and product ID pairs of the openable types. */
+static struct {
+	unsigned short vendor_id;
+	unsigned short product_id;
+} temper_type_ids[TEMPER_TYPE_COUNT];
+
+/** The number of entries in temper_type_ids. */
+static int temper_type_id_count = 0;
+
+#ifdef TEMPERED_HAVE_PTHREADS
+/** Makes sure the indexes above are built only once, even when several threads
+ * look up types at the same time.
+ */
+static pthread_once_t temper_type_index_once = PTHREAD_ONCE_INIT;
+#else
+/** Whether the indexes above have been built yet. */
+static bool temper_type_indexed = false;
+#endif
+
+/** Compare the USB device information of a type to the given values. */
+static int temper_type_compare_key(
+	struct temper_type const * type, unsigned short vendor_id,
+	unsigned short product_id, int interface_number
+) {
+	if ( type->vendor_id != vendor_id )
+	{
+		return type->vendor_id < vendor_id ? -1 : 1;
+	}
+	if ( type->product_id != product_id )
+	{
+		return type->product_id < product_id ? -1 : 1;
+	}
+	if ( type->interface_number != interface_number )
+	{
+		return type->interface_number < interface_number ? -1 : 1;
+	}
+	return 0;
+}
+
+/** Compare two entries of temper_type_index, for qsort. */
+static int temper_type_compare( void const *a, void const *b )
+{
+	struct temper_type const *type_a = *(struct temper_type * const *) a;
+	struct temper_type const *type_b = *(struct temper_type * const *) b;
+	int result = temper_type_compare_key(
+		type_a, type_b->vendor_id, type_b->product_id, type_b->interface_number
+	);
+	if ( result == 0 )
+	{
+		// Keep duplicates in table order, so the first one is found.
+		result = ( type_a < type_b ? -1 : type_a > type_b ? 1 : 0 );
+	}
+	return result;
+}
+
+/** Build the type and subtype indexes from the known_temper_types table. */
+static void temper_type_build_index__once( void )
+{
+	size_t i;
+	for ( i = 0; i < TEMPER_TYPE_COUNT; i++ )
+	{
+		struct temper_type *type = &known_temper_types[i];
+		temper_type_index[i] = type;
+		if ( type->subtypes == NULL )
+		{
+			continue;
+		}
+		int j;
+		for ( j = 0; type->subtypes[j] != NULL; j++ )
+		{
+			struct temper_subtype *subtype = type->subtypes[j];
+			if ( temper_subtype_index[i][subtype->id] == NULL )
+			{
+				temper_subtype_index[i][subtype->id] = subtype;
+			}
+		}
+	}
+	qsort(
+		temper_type_index, TEMPER_TYPE_COUNT, sizeof( struct temper_type * ),
+		temper_type_compare
+	);
+	temper_type_id_count = 0;
+	for ( i = 0; i < TEMPER_TYPE_COUNT; i++ )
+	{
+		struct temper_type *type = temper_type_index[i];
+		int last = temper_type_id_count - 1;
+		if (
+			type->open == NULL || (
+				last >= 0 &&
+				temper_type_ids[last].vendor_id == type->vendor_id &&
+				temper_type_ids[last].product_id == type->product_id
+			)
+		) {
+			continue;
+		}
+		temper_type_ids[temper_type_id_count].vendor_id = type->vendor_id;
+		temper_type_ids[temper_type_id_count].product_id = type->product_id;
+		temper_type_id_count++;
+	}
+}
+
+/** Build the type and subtype indexes, unless that has been done already. */
+static void temper_type_build_index( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_once( &temper_type_index_once, temper_type_build_index__once );
+#else
+	if ( !temper_type_indexed )
+	{
+		temper_type_build_index__once();
+		temper_type_indexed = true;
+	}
+#endif
+}
+
 // Get the temper_type that matches the given USB device information
 struct temper_type* temper_type_find(
 	unsigned short vendor_id, unsigned short product_id, int interface_number
 ) {
-	struct temper_type *type;
-	for ( type = known_temper_types; type->name != NULL; type++ )
+	temper_type_build_index();
+	size_t low = 0, high = TEMPER_TYPE_COUNT;
+	while ( low < high )
 	{
+		size_t middle = low + ( high - low ) / 2;
 		if (
-			type->vendor_id == vendor_id &&
-			type->product_id == product_id &&
-			type->interface_number == interface_number
+			temper_type_compare_key(
+				temper_type_index[middle], vendor_id, product_id,
+				interface_number
+			) < 0
 		) {
-			return type;
+			low = middle + 1;
 		}
+		else
+		{
+			high = middle;
+		}
+	}
+	if (
+		low < TEMPER_TYPE_COUNT &&
+		temper_type_compare_key(
+			temper_type_index[low], vendor_id, product_id, interface_number
+		) == 0
+	) {
+		return temper_type_index[low];
+	}
+	if (
+		temper_type_compare_key(
+			&tempered_type_hid_sim_type, vendor_id, product_id,
+			interface_number
+		) == 0
+	) {
+		// This is not in the table, so that only simulated devices have it.
+		return &tempered_type_hid_sim_type;
 	}
 	return NULL;
 }
 
+// Get the USB IDs of the index'th distinct device that can be opened.
+bool temper_type_get_ids(
+	int index, unsigned short *vendor_id, unsigned short *product_id
+) {
+	temper_type_build_index();
+	if ( index < 0 || index >= temper_type_id_count )
+	{
+		return false;
+	}
+	*vendor_id = temper_type_ids[index].vendor_id;
+	*product_id = temper_type_ids[index].product_id;
+	return true;
+}
+
+// Check whether any type that can be opened has the given USB IDs.
+bool temper_type_is_known(
+	unsigned short vendor_id, unsigned short product_id
+) {
+	temper_type_build_index();
+	int low = 0, high = temper_type_id_count;
+	while ( low < high )
+	{
+		int middle = low + ( high - low ) / 2;
+		if (
+			temper_type_ids[middle].vendor_id < vendor_id || (
+				temper_type_ids[middle].vendor_id == vendor_id &&
+				temper_type_ids[middle].product_id < product_id
+			)
+		) {
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+	return low < temper_type_id_count &&
+		temper_type_ids[low].vendor_id == vendor_id &&
+		temper_type_ids[low].product_id == product_id;
+}
+
 // Find the subtype of the given temper_type that has the given subtype ID.
 struct temper_subtype* temper_type_find_subtype(
 	struct temper_type const * type, unsigned char subtype_id
 ) {
+	temper_type_build_index();
+	if (
+		type >= known_temper_types &&
+		type < known_temper_types + TEMPER_TYPE_COUNT
+	) {
+		return temper_subtype_index[type - known_temper_types][subtype_id];
+	}
 	int i = 0;
 	while ( type->subtypes[i] != NULL && type->subtypes[i]->id != subtype_id )
 	{
@@ -443,6 +720,7 @@ struct temper_subtype* temper_type_find_subtype(
 /** Initialize the TEMPer types. */
 bool temper_type_init( char **error )
 {
+	temper_type_build_index();
 	return tempered_type_hid_init( error );
 }
 
@@ -452,8 +730,47 @@ bool temper_type_exit( char **error )
 	return tempered_type_hid_exit( error );
 }
 
+/** Select the transport used to talk to the TEMPer devices. */
+bool temper_type_set_transport( char const *name, char **error )
+{
+	return tempered_type_hid_set_transport( name, error );
+}
+
 /** Enumerate the known TEMPer devices. */
 struct tempered_device_list* temper_type_enumerate( char **error )
 {
 	return tempered_type_hid_enumerate( error );
 }
+
+/** Identify the device with the given path. */
+bool temper_type_identify_path(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+) {
+	return tempered_type_hid_identify(
+		path, vendor_id, product_id, interface_number, error
+	);
+}
+
+/** Convert the raw temperature code of a sensor to thousandths of a degree. */
+bool temper_type_raw_to_milli_celsius(
+	struct tempered_raw_reading const *raw, int *milli_celsius
+) {
+	return tempered_type_hid_raw_to_milli_celsius( raw, milli_celsius );
+}
+
+/** Convert the raw humidity code of a sensor to thousandths of a percent. */
+bool temper_type_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const *raw, int *milli_rel_hum
+) {
+	return tempered_type_hid_raw_to_milli_rel_hum( raw, milli_rel_hum );
+}
+
+#ifdef TEMPERED_HAVE_HIDRAW
+/** Identify the hidraw device node with the given name. */
+bool temper_type_identify_hidraw(
+	char const *name, struct tempered_device_list_builder *builder
+) {
+	return tempered_type_hid_hidraw_identify( name, builder );
+}
+#endif
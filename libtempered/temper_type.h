@@ -5,6 +5,9 @@
 
 #include "tempered.h"
 
+struct tempered_uring;
+struct tempered_device_list_builder;
+
 /** This struct represents a subtype of a recognized device type.
  */
 struct temper_subtype {
@@ -34,6 +37,16 @@ struct temper_subtype {
 	 */
 	bool (*read_sensors)( tempered_device* );
 	
+	/** The method to use to start reading the sensors on a device of this
+	 * subtype without waiting for the result.
+	 */
+	bool (*read_sensors_start)( tempered_device* );
+	
+	/** The method to use to finish a read that was started with the
+	 * read_sensors_start method, returning one of the TEMPERED_READ_* values.
+	 */
+	int (*read_sensors_finish)( tempered_device* );
+	
 	/** The method to use to get the sensor count for a device of this subtype.
 	 */
 	int (*get_sensor_count)( tempered_device* );
@@ -43,6 +56,13 @@ struct temper_subtype {
 	 */
 	int (*get_sensor_type)( tempered_device*, int );
 	
+	/** The method to use to get the values of the first sensors (up to the
+	 * given count, which is at most the sensor count) of a device of this
+	 * subtype in one pass, returning how many sensors were stored.
+	 * If this is NULL, the other getters are called for each sensor instead.
+	 */
+	int (*get_readings)( tempered_device*, struct tempered_reading*, int );
+	
 	/** The method to use to get the temperature from a device of this subtype.
 	 */
 	bool (*get_temperature)( tempered_device*, int, float* );
@@ -57,7 +77,7 @@ struct temper_subtype {
  * from its sensor.
  */
 struct temper_type {
-	
+
 	/** Name of device type, and end-of-list marker (this is NULL at EOL).
 	 */
 	char *name;
@@ -85,6 +105,54 @@ struct temper_type {
 	 */
 	void (*close)( tempered_device* );
 	
+	/** The method to use to get the file descriptor that can be polled for
+	 * the results of a read on this kind of device.
+	 */
+	int (*get_pollfd)( tempered_device* );
+	
+	/** The method to use to attach a device of this type to an io_uring (or
+	 * to detach it, given NULL), so that its queries can be batched with
+	 * those of other devices. This is NULL if the type cannot do that.
+	 */
+	bool (*set_uring)( tempered_device*, struct tempered_uring* );
+	
+	/** The method to use to get the array of raw reports that a device of this
+	 * type stores its sensor data in, and the number of reports in it.
+	 * This is NULL if the type does not store its data in reports.
+	 */
+	struct tempered_report* (*get_reports)( tempered_device*, int* );
+	
+	/** The method to use to make a device of this type store its raw reports
+	 * in the given caller-owned array, or in an array of its own given NULL.
+	 */
+	bool (*set_reports)( tempered_device*, struct tempered_report* );
+	
+	/** The method to use to get the array of times at which each of the raw
+	 * reports of a device of this type was read, which has as many entries as
+	 * get_reports gives reports. This is NULL if the type does not keep track.
+	 */
+	struct tempered_reading_time* (*get_report_times)( tempered_device*, int* );
+	
+	/** The method to use to get a string describing where a device of this
+	 * type is attached (e.g. its USB port), which stays the same when the
+	 * device is plugged in again at the same place. This is NULL if the type
+	 * cannot tell, in which case the device path is used instead.
+	 */
+	bool (*get_location)( tempered_device*, char*, int );
+	
+	/** The method to use to get the times at which the current values of the
+	 * given sensor of a device of this type were read. This is NULL if the
+	 * type does not keep track of that.
+	 */
+	bool (*get_reading_time)(
+		tempered_device*, int, struct tempered_reading_time*
+	);
+	
+	/** The method to use to get the raw codes that the given sensor of a
+	 * device of this type reported. This is NULL if the type cannot tell.
+	 */
+	bool (*get_raw)( tempered_device*, int, struct tempered_raw_reading* );
+	
 	/** The method to use to get the subtype ID from this kind of device.
 	 */
 	bool (*get_subtype_id)( tempered_device*, unsigned char* );
@@ -96,7 +164,7 @@ struct temper_type {
 	/** The list of subtypes for this device type.
 	 */
 	struct temper_subtype **subtypes;
-	
+
 };
 
 /** Find the temper_type struct that matches the given USB device information.
@@ -110,6 +178,28 @@ struct temper_type* temper_type_find(
 	unsigned short vendor_id, unsigned short product_id, int interface_number
 );
 
+/** Get the USB IDs of one of the known devices that can be opened.
+ * Each vendor and product ID pair is only returned once, even when several
+ * types (e.g. for different interfaces) share it, so that enumeration can ask
+ * for just these devices instead of going through every HID device.
+ * @param index Which of the ID pairs to get, counting from 0.
+ * @param vendor_id Where to store the USB vendor ID.
+ * @param product_id Where to store the USB product ID.
+ * @return Whether or not there was an ID pair with that index.
+ */
+bool temper_type_get_ids(
+	int index, unsigned short *vendor_id, unsigned short *product_id
+);
+
+/** Check whether any type that can be opened has the given USB IDs.
+ * @param vendor_id The USB vendor ID to look for.
+ * @param product_id The USB product ID to look for.
+ * @return Whether or not a device with those IDs might be a TEMPer device.
+ */
+bool temper_type_is_known(
+	unsigned short vendor_id, unsigned short product_id
+);
+
 /** Find the subtype of the given temper_type that has the given subtype ID.
  * @param type The temper_type the subtype belongs to.
  * @param subtype_id The subtype ID of the subtype to find.
@@ -126,6 +216,9 @@ bool temper_type_init( char **error );
 /** Finalize the TEMPer types. */
 bool temper_type_exit( char **error );
 
+/** Select the transport used to talk to the TEMPer devices. */
+bool temper_type_set_transport( char const *name, char **error );
+
 /** Enumerate the known TEMPer devices.
  *
  * This function returns a linked list of all the recognized TEMPer devices
@@ -140,4 +233,46 @@ bool temper_type_exit( char **error );
  */
 struct tempered_device_list* temper_type_enumerate( char **error );
 
+/** Identify the device with the given path without enumerating all devices.
+ * @param path The path of the device, as in tempered_device_list.
+ * @param vendor_id Where to store the USB vendor ID of the device.
+ * @param product_id Where to store the USB product ID of the device.
+ * @param interface_number Where to store the USB interface number.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message.
+ * @return Whether or not the device was identified.
+ */
+bool temper_type_identify_path(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+);
+
+/** Convert the raw temperature code of a sensor to thousandths of a degree.
+ * @return false if the raw reading has no temperature code or its format is
+ * unknown.
+ */
+bool temper_type_raw_to_milli_celsius(
+	struct tempered_raw_reading const *raw, int *milli_celsius
+);
+
+/** Convert the raw humidity code of a sensor to thousandths of a percent.
+ * @return false if the raw reading is missing the humidity or temperature
+ * code, or its format is unknown.
+ */
+bool temper_type_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const *raw, int *milli_rel_hum
+);
+
+#ifdef TEMPERED_HAVE_HIDRAW
+/** Identify the hidraw device node with the given name (e.g. "hidraw0").
+ * @param name The name of the device node, relative to /dev.
+ * @param builder The device list that the device is added to if it is a
+ * recognized TEMPer device.
+ * @return false if there was no memory to add the device, true otherwise.
+ */
+bool temper_type_identify_hidraw(
+	char const *name, struct tempered_device_list_builder *builder
+);
+#endif
+
 #endif
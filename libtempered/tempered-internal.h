@@ -6,10 +6,49 @@
  * be used by the programs that use this library.
  */
 
+#include <stddef.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
 #include "tempered.h"
 
 #include "temper_type.h"
 
+/** The size of the buffer that a device's error message is formatted in. */
+#define TEMPERED_ERROR_MESSAGE_SIZE 256
+
+/** The size of a buffer that is big enough for a system error message. */
+#define TEMPERED_STRERROR_SIZE 128
+
+/** The longest device location that is used to name a cache file. */
+#define TEMPERED_LOCATION_MAX 512
+
+/** The measured query latency and the read timeout policy of a device. */
+struct tempered_latency
+{
+	/** The number of round trip times that have been measured. */
+	unsigned int samples;
+	
+	/** The smoothed round trip time, in milliseconds. */
+	float mean;
+	
+	/** The smoothed mean deviation of the round trip time, in milliseconds. */
+	float deviation;
+	
+	/** The factor the timeout is multiplied by after consecutive timeouts. */
+	int backoff;
+	
+	/** The lower limit for the read timeout, in milliseconds. */
+	int floor;
+	
+	/** The upper limit for the read timeout, in milliseconds. */
+	int ceiling;
+	
+	/** How many times a query that timed out is retried. */
+	int retries;
+};
+
 /** This is the actual struct the tempered_device opaque type is built from.
  */
 struct tempered_device_ {
@@ -21,14 +60,131 @@ struct tempered_device_ {
 	
 	/** The path for this device. */
 	char *path;
+
+#ifdef TEMPERED_HAVE_PTHREADS
+	/** The lock that serializes the use of this device by several threads.
+	 * This is recursive, since the public functions that lock it also call
+	 * each other (and the error functions) with it held.
+	 */
+	pthread_mutex_t mutex;
+#endif
+
+	/** The code of the last error that occurred with this device. */
+	int error_code;
+	
+	/** The detail of the last error (a string that outlives the error), to be
+	 * added to the message for its code, or NULL.
+	 */
+	char const *error_detail;
 	
-	/** The last error that occurred with this device. */
+	/** The errno value of the last error, whose text is to be added to the
+	 * message for its code, or 0.
+	 */
+	int error_errnum;
+	
+	/** The last error message, if it was set as a dynamically allocated
+	 * string rather than as an error code.
+	 */
 	char *error;
 	
+	/** Whether error_message holds the message for the last error, because
+	 * its details did not outlive the error.
+	 */
+	bool error_formatted;
+	
+	/** The message for the last error, if it was formatted when it was set.
+	 * Otherwise it is formatted when it is asked for.
+	 */
+	char error_message[TEMPERED_ERROR_MESSAGE_SIZE];
+	
 	/** Device-specific data for this device. */
 	void *data;
+	
+	/** The latency statistics and read timeout policy for this device. */
+	struct tempered_latency latency;
+	
+	/** The number of stale reports that were discarded before a query. */
+	unsigned int stale_reports;
+	
+	/** The number of reports that were discarded for not matching the query
+	 * they were read in response to.
+	 */
+	unsigned int mismatched_reports;
+	
+	/** The CLOCK_MONOTONIC time (in ns) at which the current sensor values
+	 * were read, or 0 if the sensors have not been read yet.
+	 */
+	long long read_time;
+	
+	/** The sequence number of the current sensor values, which is increased
+	 * whenever different values are read.
+	 */
+	unsigned int sequence;
+	
+	/** The sequence number that the current sensor values have in the shared
+	 * read cache, or 0 if they were not taken from or stored in it.
+	 */
+	unsigned int shared_sequence;
 };
 
+/** This struct is used to build a device list that is returned as a single
+ * allocation, by collecting the entries and their paths in growing buffers.
+ * @see tempered_device_list_builder_finish()
+ */
+struct tempered_device_list_builder
+{
+	/** The entries that have been added so far. Their path and next fields
+	 * are only filled in by tempered_device_list_builder_finish().
+	 */
+	struct tempered_device_list *entries;
+	
+	/** The number of entries that have been added. */
+	int count;
+	
+	/** The number of entries there is room for. */
+	int capacity;
+	
+	/** The paths of the entries, each followed by a NUL, in entry order. */
+	char *paths;
+	
+	/** The number of bytes of paths that are used. */
+	size_t paths_size;
+	
+	/** The number of bytes of paths there is room for. */
+	size_t paths_capacity;
+};
+
+/** Start building a device list with the given builder. */
+void tempered_device_list_builder_init(
+	struct tempered_device_list_builder *builder
+);
+
+/** Add a device to the list that is being built.
+ * @return Whether or not there was memory for it.
+ */
+bool tempered_device_list_builder_add(
+	struct tempered_device_list_builder *builder, char const *path,
+	char *type_name, unsigned short vendor_id, unsigned short product_id,
+	int interface_number
+);
+
+/** Finish building the device list, packing its entries and paths into a
+ * single allocation that tempered_free_device_list() frees.
+ * The builder is freed by this, whether or not it succeeds.
+ * @param sort Whether to sort the entries by path.
+ * @param error If this is not NULL and there is no memory for the list, it
+ * is set to the error message.
+ * @return The list, or NULL if it is empty or on error.
+ */
+struct tempered_device_list* tempered_device_list_builder_finish(
+	struct tempered_device_list_builder *builder, bool sort, char **error
+);
+
+/** Free a device list builder without building the list. */
+void tempered_device_list_builder_free(
+	struct tempered_device_list_builder *builder
+);
+
 /** Set the last error message for the given device.
  * @param device The device for which to set the last error message.
  * Note that if this parameter is NULL, the given error message will not be
@@ -40,4 +196,136 @@ struct tempered_device_ {
  */
 void tempered_set_error( tempered_device *device, char *error );
 
+/** Set the last error for the given device to the given error code.
+ * This does not allocate anything; the message is only formatted when it is
+ * asked for with tempered_error().
+ * @param device The device for which to set the last error.
+ * @param code One of the TEMPERED_ERROR_* codes.
+ * @param detail A detail to add to the message for the code, or NULL. This
+ * must outlive the error, so it is usually a string constant.
+ * @param errnum An errno value whose text to add to the message, or 0.
+ */
+void tempered_set_error_code(
+	tempered_device *device, int code, char const *detail, int errnum
+);
+
+/** Set the last error for the given device to the given error code, with a
+ * message that is formatted right away into the device's message buffer.
+ * This is for details that do not outlive the error, and does not allocate.
+ */
+void tempered_set_error_message(
+	tempered_device *device, int code, char const *format, ...
+)
+#ifdef __GNUC__
+	__attribute__(( format( printf, 3, 4 ) ))
+#endif
+;
+
+/** Lock the given device for use by the calling thread.
+ * The lock is recursive, so this may be called again by the thread holding it,
+ * as long as each call is matched by a call to tempered_unlock().
+ */
+void tempered_lock( tempered_device *device );
+
+/** Unlock the given device, after it was locked with tempered_lock(). */
+void tempered_unlock( tempered_device *device );
+
+/** Get the text for the given errno value, like strerror() but thread-safe.
+ * @return The text, which is either in the given buffer or a string constant.
+ */
+char const * tempered_strerror_r( int errnum, char *buffer, size_t size );
+
+/** Format a message into a newly allocated string, like asprintf().
+ * @return The string, which the caller must free, or NULL if the message could
+ * not be formatted or there was no memory for it.
+ */
+char* tempered_format_string( char const *format, ... )
+#ifdef __GNUC__
+	__attribute__(( format( printf, 1, 2 ) ))
+#endif
+;
+
+/** Take the last error message of the given device, for returning it from a
+ * function that reports errors as dynamically allocated strings.
+ * @return The message, which the caller must free, or NULL if there is none.
+ */
+char* tempered_take_error( tempered_device *device );
+
+/** Attach the given device to an io_uring, or detach it if ring is NULL.
+ * While attached, the device's queries are queued on the ring instead of being
+ * written directly, and its reads only return what the ring has read.
+ * @return Whether or not the device supports this and was attached.
+ */
+bool tempered_set_uring( tempered_device *device, struct tempered_uring *ring );
+
+/** Look up the subtype ID of the given device in the subtype cache.
+ * The entry is only used if it was stored for a device of the same type at
+ * the same location, and names a known subtype of that type.
+ * @return Whether or not a valid subtype ID was found.
+ */
+bool tempered_subtype_cache_load(
+	tempered_device *device, unsigned char *subtype_id
+);
+
+/** Store the subtype ID that was detected for the given device in the
+ * subtype cache, if the cache is enabled. Errors are ignored.
+ */
+void tempered_subtype_cache_store(
+	tempered_device *device, unsigned char subtype_id
+);
+
+/** Remove the given device from the subtype cache, so that the next time it
+ * is opened its subtype is detected by asking it again.
+ */
+void tempered_subtype_cache_forget( tempered_device *device );
+
+/** Get the location of the given device, and a file name for it.
+ * The location is where the device is attached (e.g. its USB port) when the
+ * device type can tell, and its path otherwise. The name is the location with
+ * the characters that are not safe in a file name replaced, so different
+ * locations can have the same name; the location should be stored in the file
+ * and checked when it is read.
+ * @param location The buffer for the location, with room for
+ * TEMPERED_LOCATION_MAX characters.
+ * @param name The buffer for the name, of the same size.
+ * @return false if the device has no usable location.
+ */
+bool tempered_get_location_name(
+	tempered_device *device, char *location, char *name
+);
+
+/** Make sure the sensor values of the given device are no older than the
+ * given age, using the shared read cache if it is enabled: the values are
+ * taken from there if another process has read them recently enough, and
+ * otherwise the sensors are read (while the other processes wait) and the
+ * values stored there. The device must be locked.
+ * @param max_age The maximum age of the values, in nanoseconds.
+ * @return Whether or not the sensor values were read or taken from the cache.
+ */
+bool tempered_read_cache_read( tempered_device *device, long long max_age );
+
+/** Get the current CLOCK_MONOTONIC time in nanoseconds. */
+long long tempered_monotonic_ns( void );
+
+/** Get the current CLOCK_REALTIME time in nanoseconds. */
+long long tempered_realtime_ns( void );
+
+/** Reset the given latency statistics and timeout policy to the defaults. */
+void tempered_latency_init( struct tempered_latency *latency );
+
+/** Record a measured query round trip time (in ns) for the given device. */
+void tempered_latency_sample( tempered_device *device, long long duration );
+
+/** Record that a query on the given device timed out, backing off the timeout
+ * until the next successful query.
+ */
+void tempered_latency_timeout( tempered_device *device );
+
+/** Get the current read timeout for the given device, in milliseconds.
+ * This is the smoothed round trip time plus four times its deviation, clamped
+ * to the floor and ceiling of the device's policy, or the ceiling if nothing
+ * has been measured yet.
+ */
+int tempered_latency_get_timeout( tempered_device *device );
+
 #endif
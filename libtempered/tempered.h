@@ -24,6 +24,85 @@ extern "C" {
 #define TEMPERED_SENSOR_TYPE_HUMIDITY    (1 << 1)
 
 
+/** The raw codes of the sensor cannot be converted by the library. */
+#define TEMPERED_RAW_FORMAT_NONE   (0)
+
+/** The raw codes are from an FM75 (or compatible) temperature sensor. */
+#define TEMPERED_RAW_FORMAT_FM75   (1)
+
+/** The raw codes are from a Sensirion SHT1x temperature/humidity sensor. */
+#define TEMPERED_RAW_FORMAT_SHT1X  (2)
+
+/** The raw codes are from a Silicon Labs Si7005 temperature/humidity sensor. */
+#define TEMPERED_RAW_FORMAT_SI7005 (3)
+
+
+/** The read has failed; see tempered_error() for the reason. */
+#define TEMPERED_READ_ERROR   (-1)
+
+/** The read is still in progress; wait for the poll fd and try again. */
+#define TEMPERED_READ_PENDING (0 )
+
+/** The read has completed, and the new sensor values are available. */
+#define TEMPERED_READ_DONE    (1 )
+
+
+/** No error has occurred. */
+#define TEMPERED_ERROR_NONE              (0 )
+
+/** An error occurred that has no code of its own; see tempered_error(). */
+#define TEMPERED_ERROR_OTHER             (1 )
+
+/** There was not enough memory. */
+#define TEMPERED_ERROR_NO_MEMORY         (2 )
+
+/** An invalid parameter was given. */
+#define TEMPERED_ERROR_INVALID_PARAMETER (3 )
+
+/** The given sensor ID is out of range. */
+#define TEMPERED_ERROR_SENSOR_RANGE      (4 )
+
+/** The device type does not support the requested operation. */
+#define TEMPERED_ERROR_NOT_SUPPORTED     (5 )
+
+/** The sensor does not support the requested value. */
+#define TEMPERED_ERROR_SENSOR_TYPE       (6 )
+
+/** Writing a query to the device failed. */
+#define TEMPERED_ERROR_WRITE             (7 )
+
+/** Reading a response from the device failed. */
+#define TEMPERED_ERROR_READ              (8 )
+
+/** The device did not respond in time. */
+#define TEMPERED_ERROR_TIMEOUT           (9 )
+
+/** The device responded with less data than was expected. */
+#define TEMPERED_ERROR_SHORT_READ        (10)
+
+/** The operation needs a read of the sensors to be started first. */
+#define TEMPERED_ERROR_NOT_STARTED       (11)
+
+/** The operation cannot be done while a read is in progress. */
+#define TEMPERED_ERROR_BUSY              (12)
+
+/** The requested data is not available yet. */
+#define TEMPERED_ERROR_NO_DATA           (13)
+
+/** The device is already in the device set. */
+#define TEMPERED_ERROR_ALREADY_ADDED     (14)
+
+/** Something happened that should never happen. */
+#define TEMPERED_ERROR_INTERNAL          (15)
+
+
+/** A device has been attached, and can now be opened. */
+#define TEMPERED_MONITOR_ADDED   (1)
+
+/** A device has been detached, and should be closed if it is open. */
+#define TEMPERED_MONITOR_REMOVED (2)
+
+
 /** This struct represents a linked list of enumerated TEMPer devices.
  * @see tempered_enumerate()
  */
@@ -54,6 +133,157 @@ struct tempered_device_list {
 	int interface_number;
 };
 
+/** The largest number of bytes of a report that a struct tempered_report holds.
+ * This makes the struct 64 bytes in size, which is a common cache line size.
+ * Reading a device fails with TEMPERED_ERROR_READ if it answers with a longer
+ * report, rather than storing only part of it.
+ */
+#define TEMPERED_REPORT_SIZE 60
+
+/** This struct holds a raw report that was read back from a device.
+ * @see tempered_set_reports()
+ */
+struct tempered_report {
+	/** How many bytes of data were read from the device.
+	 */
+	int length;
+	
+	/** The data that was read from the device.
+	 */
+	unsigned char data[TEMPERED_REPORT_SIZE];
+};
+
+/** This struct holds the values of a single sensor of a device.
+ * @see tempered_get_readings()
+ */
+struct tempered_reading {
+	/** The ID of the sensor these values are from.
+	 */
+	int sensor;
+	
+	/** The type of the sensor, made up of the TEMPERED_SENSOR_TYPE_* constants,
+	 * as returned by tempered_get_sensor_type().
+	 */
+	int type;
+	
+	/** Which of the values were successfully retrieved, made up of the
+	 * TEMPERED_SENSOR_TYPE_* constants. The other values are 0.
+	 */
+	int status;
+	
+	/** The temperature, in degrees Celsius.
+	 */
+	float tempC;
+	
+	/** The relative humidity, in percent.
+	 */
+	float rel_hum;
+};
+
+/** This struct holds the times at which the values of a sensor were read.
+ *
+ * The times are CLOCK_MONOTONIC times in nanoseconds, so they can be compared
+ * between devices (and with clock_gettime() in the program). The differences
+ * between them split the latency into its phases: write_done - write_start is
+ * the time spent sending the query, response - write_done is the time the
+ * device took to measure and respond, and completed - response is the time
+ * the library took to handle the response.
+ * @see tempered_get_reading_time()
+ */
+struct tempered_reading_time {
+	/** When the query for the sensor's values was about to be written.
+	 */
+	long long write_start;
+	
+	/** When the write of the query returned. When the device is read through
+	 * a device set that uses io_uring, this is when the write was queued.
+	 */
+	long long write_done;
+	
+	/** When the response was read from the device. A HID report arrives all
+	 * at once, so this is also when its first byte was available to the
+	 * library; with tempered_read_sensors_start(), it is when the response
+	 * was picked up by tempered_read_sensors_finish().
+	 */
+	long long response;
+	
+	/** When the response had been checked and stored, ready for the values
+	 * to be decoded from it.
+	 */
+	long long completed;
+};
+
+/** This struct holds the raw codes that a single sensor of a device reported.
+ *
+ * Together with the format, the codes hold all the information the values
+ * are computed from, so they can be stored instead of the values and be
+ * converted later (e.g. with tempered_raw_to_milli_celsius()).
+ * @see tempered_get_raw()
+ */
+struct tempered_raw_reading {
+	/** The ID of the sensor these codes are from.
+	 */
+	int sensor;
+	
+	/** The format of the codes, which is one of the TEMPERED_RAW_FORMAT_*
+	 * constants.
+	 */
+	int format;
+	
+	/** Which of the codes were retrieved, made up of the
+	 * TEMPERED_SENSOR_TYPE_* constants. The other codes are 0.
+	 */
+	int status;
+	
+	/** The raw temperature code, as the 16 bits the sensor reported.
+	 */
+	unsigned short temperature;
+	
+	/** The raw humidity code, as the 16 bits the sensor reported.
+	 */
+	unsigned short humidity;
+};
+
+/** The largest number of sensors that a struct tempered_sample holds the
+ * values of, which is more than any of the supported devices has.
+ */
+#define TEMPERED_SAMPLE_MAX_SENSORS 4
+
+/** This struct holds the values of all the sensors of a device, as they were
+ * read at one point in time by a sampler.
+ * @see tempered_sampler_pop_batch()
+ */
+struct tempered_sample {
+	/** The CLOCK_MONOTONIC time (in ns) that this read was scheduled for.
+	 * These are exact multiples of the interval apart, no matter how long
+	 * the reads take.
+	 */
+	long long scheduled;
+	
+	/** The CLOCK_MONOTONIC time (in ns) at which the read was done.
+	 */
+	long long completed;
+	
+	/** The sequence number that the values got from the device, as given by
+	 * tempered_get_read_sequence().
+	 */
+	unsigned int sequence;
+	
+	/** TEMPERED_ERROR_NONE if the sensors were read, or the code of the error
+	 * that made the read fail (in which case there are no readings).
+	 */
+	int error;
+	
+	/** The number of readings in this sample.
+	 */
+	int count;
+	
+	/** The values of the sensors, in sensor ID order, as they would be
+	 * returned by tempered_get_readings().
+	 */
+	struct tempered_reading readings[TEMPERED_SAMPLE_MAX_SENSORS];
+};
+
 struct tempered_device_;
 
 /** This type represents an opened TEMPer device.
@@ -63,12 +293,80 @@ struct tempered_device_;
  */
 typedef struct tempered_device_ tempered_device;
 
+struct tempered_device_set_;
+
+/** This type represents a set of opened devices that are read together.
+ *
+ * This is an opaque type.
+ * @see tempered_device_set_create()
+ */
+typedef struct tempered_device_set_ tempered_device_set;
+
+/** This type represents a pool of threads that read devices in parallel.
+ *
+ * This is an opaque type.
+ * @see tempered_pool_create()
+ */
+typedef struct tempered_pool_ tempered_pool;
+
+/** This type represents a thread that reads a device at a fixed interval.
+ *
+ * This is an opaque type.
+ * @see tempered_sampler_start()
+ */
+typedef struct tempered_sampler_ tempered_sampler;
+
+struct tempered_monitor_;
+
+/** This type represents a monitor that watches for devices being attached and
+ * detached.
+ * @see tempered_monitor_create()
+ */
+typedef struct tempered_monitor_ tempered_monitor;
+
+/** The type of function that a monitor calls when a device is added or
+ * removed.
+ * @param monitor The monitor that noticed the change.
+ * @param event Either TEMPERED_MONITOR_ADDED or TEMPERED_MONITOR_REMOVED.
+ * @param device The device that was added or removed. This entry is owned by
+ * the monitor; a removed device's entry is freed when the callback returns.
+ * @param user_data The user data that was given to tempered_monitor_create().
+ */
+typedef void (*tempered_monitor_callback)(
+	tempered_monitor *monitor, int event, struct tempered_device_list *device,
+	void *user_data
+);
+
+/** The type of function that tempered_pool_read() calls for each device.
+ * @param device The device whose sensors were read.
+ * @param success Whether or not the sensors were successfully read. If not,
+ * the reason can be found with tempered_error() on the device.
+ * @param user_data The user_data pointer given to tempered_pool_read().
+ */
+typedef void (*tempered_pool_callback)(
+	tempered_device *device, bool success, void *user_data
+);
+
 /** Initialize the TEMPered library.
  *
  * This function initializes the TEMPered library. Calling it is not strictly
- * necessary, as it will be called automatically when needed, but should be
- * called at the start of execution if there's a chance the library will be
- * used by multiple threads simultaneously.
+ * necessary, as it will be called automatically when needed, and it only does
+ * the initialization once, however many threads call it (or use the library
+ * without calling it) at the same time.
+ *
+ * When built with pthreads, the library can be used by several threads at
+ * once, under these rules:
+ * - Enumerating and opening devices is safe from any thread.
+ * - Each open device has its own lock, which every function that is given the
+ *   device holds while using it. Threads that use different devices therefore
+ *   never wait for each other, while threads that share a device take turns.
+ *   A device must still not be closed while another thread may be using it.
+ * - The message returned by tempered_error() is copied into a buffer of the
+ *   calling thread, so other threads using the device do not change it.
+ * - tempered_exit() and tempered_set_transport() must not be called while
+ *   other threads are using the library.
+ * - While a device is in a device set, it should only be read through that
+ *   set, which is itself meant to be used by one thread at a time.
  * @param error If an error occurs and this is not NULL, it will be set to the
  * error message. The returned string is dynamically allocated, and should be
  * freed when you're done with it.
@@ -86,10 +384,97 @@ bool tempered_init( char **error );
  */
 bool tempered_exit( char **error );
 
+/** Select the transport used to talk to the devices.
+ *
+ * The transport decides how the library finds and talks to the devices. If
+ * this function is not called, the transport named by the TEMPERED_TRANSPORT
+ * environment variable is used, or "hidapi" if that variable is not set (or
+ * "hidraw" if the library was built without HIDAPI).
+ *
+ * The known transports are:
+ * - "hidapi": uses the HIDAPI library to talk to real devices.
+ * - "hidraw": uses the Linux hidraw device nodes directly (Linux only). The
+ *   devices are enumerated from sysfs, without opening any of them. This can
+ *   be followed by a colon and the option sysfs=DIR, to look the devices up
+ *   under DIR instead of /sys (e.g. in a synthetic tree, for testing).
+ * - "sim": simulates devices in-process, without touching any hardware. This
+ *   can be followed by a colon and a comma-separated list of options, e.g.
+ *   "sim:devices=200,latency=4,jitter=2,drop=0.01", where the options are:
+ *   devices=N     The number of devices to simulate (default 1).
+ *   type=V:P[:I]  The USB IDs (in hex) of the simulated devices' type
+ *                 (default 0c45:7401). The type 0000:0001 only exists in
+ *                 the simulation; it has two sensor groups whose queries
+ *                 are sent at once, unlike any of the real types.
+ *   subtype=N     The subtype ID the devices report (default: the first).
+ *   data=XX:XX... The bytes sent back for sensor queries, in hex.
+ *   latency=MS    How long the devices take to respond, in milliseconds.
+ *   jitter=MS     The maximum random delay added to the latency.
+ *   fail=P        The probability (0 to 1) of a write or read error.
+ *   drop=P        The probability (0 to 1) of a query never being answered.
+ *   seed=N        The seed for the random numbers used by the above.
+ *
+ * This should be called before enumerating or opening any devices, and must
+ * not be called while any devices are open.
+ * @param name The name of the transport, optionally followed by a colon and
+ * the transport options.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return true on success, false on error.
+ */
+bool tempered_set_transport( char const *name, char **error );
+
+/** Set the directory that the detected device subtypes are cached in.
+ *
+ * Opening a device normally means asking it which subtype it is, which takes
+ * one or more USB round trips. With a cache directory set, the subtype that is
+ * detected is stored in a small file named after where the device is attached
+ * (its USB port, or its path if the transport cannot tell), and the next time
+ * a device of the same type is opened at that location, the subtype is taken
+ * from that file instead of asking the device. If the file does not match the
+ * device, it is ignored and the device is asked as usual.
+ *
+ * The cache is disabled by default. If this is not called, the directory is
+ * taken from the TEMPERED_SUBTYPE_CACHE environment variable (if set). The
+ * directory is not created; it must exist and be writable to store entries.
+ * @param directory The directory to use, or NULL (or "") to disable the cache.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return true on success, false on error.
+ */
+bool tempered_set_subtype_cache( char const *directory, char **error );
+
+/** Set the directory that the sensor values are shared between processes in.
+ *
+ * Normally every process that reads a device does its own USB round trips,
+ * even when several processes read the same device at about the same time.
+ * With a read cache directory set, tempered_read_sensors_cached() stores the
+ * values it reads in a file named after where the device is attached, and
+ * takes them from there when another process has read them recently enough.
+ * The file is locked while the device is read, so the other processes that
+ * want the values at the same time wait for that read instead of doing their
+ * own. Only processes on the same machine should share a directory; one that
+ * is cleared on reboot (e.g. under /run or /dev/shm) is the best choice.
+ *
+ * Sharing is disabled by default. If this is not called, the directory is
+ * taken from the TEMPERED_READ_CACHE environment variable (if set). The
+ * directory is not created; it must exist and be writable to share values.
+ * @param directory The directory to use, or NULL (or "") to disable sharing.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return true on success, false on error.
+ */
+bool tempered_set_read_cache( char const *directory, char **error );
+
 /** Enumerate the TEMPer devices.
  *
  * This function returns a linked list of all the recognized TEMPer devices
  * attached to the system (excluding the ones that are ignored).
+ * The entries of the list are also laid out as an array in a single block
+ * of memory, so they can be iterated over by index as well, e.g. as
+ * list[i] for i from 0 to tempered_device_list_count( list ) - 1.
  *
  * @param error If an error occurs and this is not NULL, it will be set to the
  * error message. The returned string is dynamically allocated, and should be
@@ -101,10 +486,18 @@ bool tempered_exit( char **error );
  */
 struct tempered_device_list* tempered_enumerate( char **error );
 
+/** Get the number of devices in the given device list.
+ * @param list The first device of the list, as returned by e.g.
+ * tempered_enumerate(). Can be NULL, which is an empty list.
+ * @return The number of devices in the list.
+ */
+int tempered_device_list_count( struct tempered_device_list *list );
+
 /** Free the memory used by the given device list.
  *
  * Once this method has been called with a list, the given list should not be
- * dereferenced.
+ * dereferenced. The whole list is a single allocation, so it is freed all at
+ * once; this must be given the first device of the list.
  *
  * @param list The device list to be freed. Can be NULL to not free anything.
  */
@@ -124,6 +517,23 @@ void tempered_free_device_list( struct tempered_device_list *list );
  */
 tempered_device* tempered_open( struct tempered_device_list *list, char **error );
 
+/** Open the device with the given path, without enumerating the devices.
+ *
+ * The type of the device is identified from its own HID information (e.g. the
+ * sysfs data of a hidraw device node), so this is much cheaper than searching
+ * the result of tempered_enumerate() for the path when it is already known.
+ * The returned handle should be closed with tempered_close() when you are done
+ * using the device.
+ * @param path The path of the device to open, as in tempered_device_list.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return The opened device, or NULL on error.
+ * @see tempered_open()
+ * @see tempered_close()
+ */
+tempered_device* tempered_open_path( char const *path, char **error );
+
 /** Close an open device.
  *
  * Once a device handle has been closed, it should no longer be used.
@@ -137,11 +547,47 @@ void tempered_close( tempered_device *device );
  * @return The last error message for the given device, or NULL if no error has
  * occurred on that device.
  *
- * The returned string must not be freed or modified, and is only valid as long
- * as the device handle is open and no further error has occurred on it.
+ * The returned string must not be freed or modified, and is only valid until
+ * the next call to this function from the same thread.
  */
 char* tempered_error( tempered_device *device );
 
+/** Get the code of the last error for the given device.
+ *
+ * Unlike tempered_error(), this does not format a message, so it is cheap to
+ * call for every device that failed a read.
+ * @param device The device for which to get the last error code.
+ * @return One of the TEMPERED_ERROR_* codes, which is TEMPERED_ERROR_NONE if no
+ * error has occurred on that device.
+ */
+int tempered_errno( tempered_device *device );
+
+/** Get the generic message for the given error code.
+ *
+ * This is the message tempered_error() starts with, without the details of
+ * the particular error (such as the system error message).
+ * @param code One of the TEMPERED_ERROR_* codes.
+ * @return The message, which is a string constant that must not be freed.
+ */
+char const * tempered_strerror( int code );
+
+/** Get the number of input reports that have been discarded for a device.
+ *
+ * Before each query is sent, any reports that are already waiting to be read
+ * are discarded, since they are late answers to earlier queries that timed
+ * out. Responses that don't start the way the query's answer should are also
+ * discarded, and the wait for the real answer continues.
+ * @param device The device to get the counts of.
+ * @param stale If not NULL, this is set to the number of reports that were
+ * discarded because they were waiting when a query was about to be sent.
+ * @param mismatched If not NULL, this is set to the number of reports that
+ * were discarded because they did not match the query they were read for.
+ * @return Whether or not the counts were retrieved.
+ */
+bool tempered_get_discarded_reports(
+	tempered_device *device, unsigned int *stale, unsigned int *mismatched
+);
+
 /** Get the number of sensors supported by the given device.
  * @param device The device to get the sensor count of.
  * @return The number of sensors this device currently has.
@@ -166,6 +612,435 @@ int tempered_get_sensor_type( tempered_device *device, int sensor );
  */
 bool tempered_read_sensors( tempered_device *device );
 
+/** Read the sensors of the given device, unless they were read recently.
+ *
+ * If the current sensor values of the device are no older than the given age,
+ * nothing is read; otherwise the sensors are read as by tempered_read_sensors.
+ * Threads that call this for the same device while it is being read wait for
+ * that read and then use its values, if they are fresh enough for them. When
+ * a read cache is set (see tempered_set_read_cache()), this is also done for
+ * other processes that read the same device.
+ *
+ * The age of the values is measured from when they were read, whichever
+ * function read them. Use tempered_get_read_sequence() to find out whether
+ * the values have changed since they were last looked at.
+ * @param device The device to read the sensors of.
+ * @param max_age_ms The maximum age of the values, in milliseconds.
+ * @return Whether or not the device has sensor values of at most that age.
+ */
+bool tempered_read_sensors_cached( tempered_device *device, int max_age_ms );
+
+/** Get the sequence number of the current sensor values of a device.
+ *
+ * This starts at 0 when the device is opened, and is increased whenever the
+ * device gets new sensor values, either by reading them or by taking them from
+ * the read cache. It does not change when tempered_read_sensors_cached() keeps
+ * the current values, so a program that polls the device can skip the work it
+ * would do for unchanged values.
+ * @param device The device to get the sequence number of.
+ * @return The sequence number, which wraps around after UINT_MAX.
+ */
+unsigned int tempered_get_read_sequence( tempered_device *device );
+
+/** Set the policy for the read timeout of the given device.
+ *
+ * Instead of always waiting a fixed amount of time for a device to respond,
+ * the round trip time of its queries is measured, and the read timeout is set
+ * to the smoothed round trip time plus four times its mean deviation (as TCP
+ * does for its retransmission timeout). After a timeout the query is sent again
+ * with a doubled timeout, up to the given number of retries.
+ *
+ * The default policy is a floor of 50 ms, a ceiling of 1000 ms and 1 retry.
+ * The ceiling is also used until a round trip time has been measured.
+ * @param device The device to set the timeout policy of.
+ * @param floor The shortest read timeout to use, in milliseconds.
+ * @param ceiling The longest read timeout to use, in milliseconds.
+ * @param retries How many times to retry a query that times out.
+ * @return Whether or not the policy was valid and has been set.
+ */
+bool tempered_set_timeout_policy(
+	tempered_device *device, int floor, int ceiling, int retries
+);
+
+/** Get the read timeout that would currently be used for the given device.
+ * @param device The device to get the read timeout of.
+ * @return The read timeout, in milliseconds.
+ * @see tempered_set_timeout_policy()
+ */
+int tempered_get_timeout( tempered_device *device );
+
+/** Get the measured query round trip time of the given device.
+ * @param device The device to get the latency of.
+ * @param mean If not NULL, this is set to the smoothed round trip time, in
+ * milliseconds.
+ * @param deviation If not NULL, this is set to the smoothed mean deviation of
+ * the round trip time, in milliseconds.
+ * @return Whether or not the latency was available; it is not until at least
+ * one query has been answered.
+ */
+bool tempered_get_latency(
+	tempered_device *device, float *mean, float *deviation
+);
+
+/** Start reading the sensors of the given device, without waiting for them.
+ *
+ * This sends the query for the sensor values to the device and returns right
+ * away. Wait for the file descriptor from tempered_get_pollfd() to become
+ * readable, and then call tempered_read_sensors_finish() to collect the
+ * result. Calling this again before the read has finished restarts the read.
+ * @param device The device to read the sensors of.
+ * @return Whether or not the read was successfully started.
+ * @see tempered_read_sensors_finish()
+ */
+bool tempered_read_sensors_start( tempered_device *device );
+
+/** Get the file descriptor to wait on for the results of a started read.
+ *
+ * The returned file descriptor becomes readable (e.g. for poll() or epoll)
+ * when the device has data for tempered_read_sensors_finish() to process.
+ * It belongs to the device, so it must not be read from or closed, and it
+ * stays the same for as long as the device is open.
+ * @param device The device to get the file descriptor of.
+ * @return The file descriptor, or -1 if the device's transport does not have
+ * one, in which case tempered_read_sensors_finish() must be called
+ * periodically instead.
+ */
+int tempered_get_pollfd( tempered_device *device );
+
+/** Continue a read that was started with tempered_read_sensors_start().
+ *
+ * This never blocks. It processes whatever data the device has sent, and may
+ * send further queries to the device when it has several groups of sensors.
+ * @param device The device to read the sensors of.
+ * @return TEMPERED_READ_DONE when the sensor values have been updated,
+ * TEMPERED_READ_PENDING if the read is still in progress (wait for the poll
+ * fd again), or TEMPERED_READ_ERROR if the read failed.
+ */
+int tempered_read_sensors_finish( tempered_device *device );
+
+/** Create a set of devices that can be read all at once.
+ *
+ * The returned set should be destroyed with tempered_device_set_destroy() when
+ * you are done using it.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return The new, empty device set, or NULL on error.
+ * @see tempered_device_set_read_all()
+ */
+tempered_device_set* tempered_device_set_create( char **error );
+
+/** Destroy a device set.
+ *
+ * The devices in the set are not closed by this; that must be done separately.
+ * @param set The device set to destroy. Can be NULL to not destroy anything.
+ */
+void tempered_device_set_destroy( tempered_device_set *set );
+
+/** Add an open device to a device set.
+ *
+ * A device must be removed from all sets it is in before it is closed.
+ * @param set The set to add the device to.
+ * @param device The device to add to the set.
+ * @return Whether or not the device was added. On failure, the reason can be
+ * found with tempered_error() on the device.
+ */
+bool tempered_device_set_add( tempered_device_set *set, tempered_device *device );
+
+/** Remove a device from a device set.
+ * @param set The set to remove the device from.
+ * @param device The device to remove from the set.
+ * @return Whether or not the device was found in (and removed from) the set.
+ */
+bool tempered_device_set_remove(
+	tempered_device_set *set, tempered_device *device
+);
+
+/** Choose whether a device set reads its devices through an io_uring.
+ *
+ * When this is enabled (the default), and every device in the set supports it
+ * (currently that means using the hidraw transport), the queries for all the
+ * devices are submitted together to the kernel with a single system call,
+ * and the responses are collected the same way, instead of using a write and
+ * a read system call per query per device. Otherwise epoll is used instead.
+ * @param set The set to change the setting of.
+ * @param enable Whether or not to use an io_uring when possible.
+ * @return Whether or not an io_uring will be tried; this is false if it was
+ * not enabled, or if the library was built without io_uring support.
+ */
+bool tempered_device_set_use_uring( tempered_device_set *set, bool enable );
+
+/** Read the sensors of all the devices in a device set at the same time.
+ *
+ * This sends the queries to all the devices at once, and then waits for all
+ * of their responses together (with epoll, on Linux), so that reading the
+ * whole set takes about as long as reading a single device.
+ * @param set The set of devices to read.
+ * @param timeout How long to wait for the devices to respond, in milliseconds.
+ * Devices that have not responded by then are considered to have failed.
+ * If this is negative, each device's own adaptive read timeout and retries
+ * are used instead.
+ * @return The number of devices whose sensors were successfully read.
+ * @see tempered_device_set_read_ok()
+ */
+int tempered_device_set_read_all( tempered_device_set *set, int timeout );
+
+/** Check whether the last read of a device in a device set succeeded.
+ * @param set The set that the device was read as part of.
+ * @param device The device to check.
+ * @return true if the last tempered_device_set_read_all() call successfully
+ * read the device's sensors, false otherwise (in which case the reason can be
+ * found with tempered_error() on the device).
+ */
+bool tempered_device_set_read_ok(
+	tempered_device_set *set, tempered_device *device
+);
+
+/** Get the number of reports needed to hold the raw data of a device set.
+ * @param set The set to get the number of reports for.
+ * @return The sum of tempered_get_report_count() over the devices in the set.
+ */
+int tempered_device_set_get_report_count( tempered_device_set *set );
+
+/** Make all the devices in a device set read into one caller-owned buffer.
+ *
+ * The buffer is divided between the devices in the order they are stored in
+ * the set, which is the order they were added in unless devices have been
+ * removed since; use tempered_get_reports() to find a device's part of it.
+ * @param set The set whose devices should read into the buffer.
+ * @param reports The buffer, which must have room for at least the number of
+ * reports given by tempered_device_set_get_report_count(). If this is NULL,
+ * the devices go back to using their own buffers.
+ * @return Whether or not all the devices were given their part of the buffer.
+ * On failure, the reason can be found with tempered_error() on the device.
+ * @see tempered_set_reports()
+ */
+bool tempered_device_set_set_reports(
+	tempered_device_set *set, struct tempered_report *reports
+);
+
+/** Create a pool of worker threads for reading devices in parallel.
+ *
+ * This is for programs that cannot use tempered_device_set_read_all() or an
+ * event loop. Note that this is only supported on platforms with pthreads.
+ * The pool should be destroyed with tempered_pool_destroy() when you are done
+ * using it.
+ * @param threads The number of worker threads to start.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return The new pool, or NULL on error.
+ * @see tempered_pool_read()
+ */
+tempered_pool* tempered_pool_create( int threads, char **error );
+
+/** Stop the worker threads of a pool and free it.
+ * @param pool The pool to destroy. Can be NULL to not destroy anything.
+ */
+void tempered_pool_destroy( tempered_pool *pool );
+
+/** Read the sensors of the given devices using the threads of a pool.
+ *
+ * The devices are divided evenly between the worker threads, each of which
+ * reads its devices one by one. A worker that runs out of devices takes over
+ * devices from the others, so a device that is slow or times out only holds
+ * up the thread that is reading it. This blocks until all the devices have
+ * been read, and the devices must not be used elsewhere until it returns.
+ * Only one read can use a pool at a time; other calls wait their turn.
+ * @param pool The pool whose threads to read the devices with.
+ * @param devices The array of devices to read.
+ * @param count The number of devices in the array.
+ * @param callback If not NULL, this is called for each device once it has
+ * been read. It is called from the worker threads, possibly several at once.
+ * @param user_data This is passed on to the callback.
+ * @return The number of devices whose sensors were successfully read.
+ */
+int tempered_pool_read(
+	tempered_pool *pool, tempered_device **devices, int count,
+	tempered_pool_callback callback, void *user_data
+);
+
+/** Start a thread that reads the sensors of a device at a fixed interval.
+ *
+ * The thread reads the device at evenly spaced times, each the interval after
+ * the one before, and stores the values it read (or the error) as a sample in
+ * a buffer that tempered_sampler_pop_batch() takes them from. This keeps the
+ * time that the USB round trips take out of the threads that use the values,
+ * and keeps the samples evenly spaced even when a read takes a while; if a
+ * read takes longer than the interval, the reads that were due in the meantime
+ * are skipped. When the buffer is full, no reads are done until there is room.
+ *
+ * The device can still be used by other threads while the sampler runs, but
+ * the sampler must be stopped with tempered_sampler_stop() before the device
+ * is closed.
+ * @param device The device to read.
+ * @param interval_ms The time between the starts of the reads, in milliseconds.
+ * The first read is done right away.
+ * @param capacity The number of samples the buffer has room for. This is
+ * rounded up to a power of two.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return The new sampler, or NULL on error.
+ */
+tempered_sampler* tempered_sampler_start(
+	tempered_device *device, int interval_ms, int capacity, char **error
+);
+
+/** Stop the thread of a sampler and free it, including any samples that were
+ * not taken yet.
+ * @param sampler The sampler to stop. Can be NULL to not stop anything.
+ */
+void tempered_sampler_stop( tempered_sampler *sampler );
+
+/** Get the file descriptor that becomes readable when a sampler has samples.
+ *
+ * Add this to your poll or epoll loop, and call tempered_sampler_pop_batch()
+ * when it becomes readable. It belongs to the sampler, so it must not be read
+ * from or closed.
+ * @param sampler The sampler to get the file descriptor of.
+ * @return The file descriptor, or -1 on error.
+ */
+int tempered_sampler_get_fd( tempered_sampler *sampler );
+
+/** Take the oldest samples that a sampler has stored.
+ *
+ * This never blocks, and never waits for the sampler's thread, since the
+ * samples are passed through a lock-free buffer. Only one thread at a time may
+ * take samples from a sampler.
+ * @param sampler The sampler to take the samples from.
+ * @param samples The array to store the samples in, oldest first.
+ * @param max The number of samples there is room for in the array.
+ * @return The number of samples that were stored, which is 0 if there were
+ * none, or -1 on error.
+ */
+int tempered_sampler_pop_batch(
+	tempered_sampler *sampler, struct tempered_sample *samples, int max
+);
+
+/** Get the number of samples that a sampler did not take.
+ * @param sampler The sampler to get the numbers of.
+ * @param full If not NULL, this is set to the number of reads that were not
+ * done because the buffer was full.
+ * @param late If not NULL, this is set to the number of reads that were
+ * skipped because the read before them took longer than the interval.
+ * @return Whether or not the numbers were retrieved.
+ */
+bool tempered_sampler_get_missed(
+	tempered_sampler *sampler, unsigned int *full, unsigned int *late
+);
+
+/** Allocate a buffer for the given number of reports.
+ *
+ * The buffer is aligned to 64 bytes, so that each report has a cache line of
+ * its own, and all of its reports start out empty. It should be freed with
+ * tempered_free_reports() once no device is using it anymore.
+ * @param count The number of reports to make room for.
+ * @return The new buffer, or NULL if it could not be allocated.
+ */
+struct tempered_report* tempered_alloc_reports( int count );
+
+/** Free a buffer that was allocated with tempered_alloc_reports().
+ * @param reports The buffer to free. Can be NULL to not free anything.
+ */
+void tempered_free_reports( struct tempered_report *reports );
+
+/** Get the number of raw reports that a device stores its sensor data in.
+ * @param device The device to get the number of reports for.
+ * @return The number of reports, or 0 if the device does not use reports.
+ */
+int tempered_get_report_count( tempered_device *device );
+
+/** Get the raw reports that were last read from the given device.
+ *
+ * These are the responses that the sensor values are decoded from, which
+ * can be useful for e.g. logging them without decoding them first.
+ * @param device The device to get the reports of.
+ * @return The array of tempered_get_report_count() reports, or NULL if the
+ * device does not use reports. This is only valid until the next call to
+ * tempered_set_reports() or tempered_close() for the device.
+ */
+struct tempered_report* tempered_get_reports( tempered_device *device );
+
+/** Make a device read its raw reports into a caller-owned buffer.
+ *
+ * The transport reads the responses from the device straight into the given
+ * buffer, instead of into memory owned by the device, so that the caller can
+ * e.g. lay out the reports of many devices next to each other, or hand them
+ * on without copying them. The current reports are copied into the buffer.
+ * The buffer must stay valid until the device is closed or given another one,
+ * and must not be changed while the device is being read.
+ * @param device The device that should read into the buffer.
+ * @param reports The buffer, which must have room for the number of reports
+ * given by tempered_get_report_count(). If this is NULL, the device goes back
+ * to using a buffer of its own.
+ * @return Whether or not the buffer was set; it cannot be changed while a read
+ * is in progress.
+ */
+bool tempered_set_reports(
+	tempered_device *device, struct tempered_report *reports
+);
+
+/** Start monitoring for TEMPer devices being attached and detached.
+ *
+ * The monitor listens for the device events that udev sends out once it has
+ * set up a device node (so this needs udev to be running), and keeps a list
+ * of the attached devices up to date from them, without enumerating them all
+ * again. The list starts out with the devices that are already attached.
+ * Note that this is only supported on Linux, and that the devices are found
+ * through their hidraw device nodes, so the paths in the list are hidraw
+ * device paths, which are meant for the hidraw transport (or a HIDAPI that
+ * was built to use hidraw).
+ * The monitor should be destroyed with tempered_monitor_destroy() when you are
+ * done using it.
+ * @param callback If not NULL, this is called for each device that is added
+ * or removed, from inside tempered_monitor_process().
+ * @param user_data This is passed on to the callback.
+ * @param error If an error occurs and this is not NULL, it will be set to the
+ * error message. The returned string is dynamically allocated, and should be
+ * freed when you're done with it.
+ * @return The new monitor, or NULL on error.
+ */
+tempered_monitor* tempered_monitor_create(
+	tempered_monitor_callback callback, void *user_data, char **error
+);
+
+/** Stop monitoring for devices, and free the monitor and its device list.
+ * @param monitor The monitor to destroy. Can be NULL to not destroy anything.
+ */
+void tempered_monitor_destroy( tempered_monitor *monitor );
+
+/** Get the file descriptor that becomes readable when devices have changed.
+ *
+ * Add this to your poll or epoll loop, and call tempered_monitor_process()
+ * when it becomes readable.
+ * @param monitor The monitor to get the file descriptor of.
+ * @return The file descriptor, or -1 on error.
+ */
+int tempered_monitor_get_fd( tempered_monitor *monitor );
+
+/** Process the device events that the monitor has received.
+ *
+ * This updates the monitor's device list, and calls the callback for each
+ * device that was added or removed. It does not block.
+ * @param monitor The monitor whose events to process.
+ * @return The number of events that were processed (including ones for other
+ * devices, which are ignored), or -1 on error.
+ */
+int tempered_monitor_process( tempered_monitor *monitor );
+
+/** Get the list of the TEMPer devices that are currently attached.
+ *
+ * The entries can be passed to tempered_open() as usual.
+ * @param monitor The monitor to get the list from.
+ * @return The first device in the list, or NULL if there are none. The list
+ * is owned by the monitor, so it must not be freed, and is only valid until
+ * the next call to tempered_monitor_process() or tempered_monitor_destroy().
+ */
+struct tempered_device_list* tempered_monitor_get_devices(
+	tempered_monitor *monitor
+);
+
 /** Get the temperature from the given device.
  *
  * Note that to get up-to-date values you must first call tempered_read_sensors.
@@ -190,6 +1065,83 @@ bool tempered_get_humidity(
 	tempered_device *device, int sensor, float *rel_hum
 );
 
+/** Get the values of all the sensors of the given device in one call.
+ *
+ * This fills in one reading per sensor, in sensor ID order, which is cheaper
+ * than calling tempered_get_sensor_type(), tempered_get_temperature() and
+ * tempered_get_humidity() for each sensor. A value that could not be
+ * retrieved is left out of the reading's status, and the device error is set
+ * to the reason, but the other values are still filled in.
+ * Note that to get up-to-date values you must first call tempered_read_sensors.
+ * @param device The device to get the sensor values from.
+ * @param readings The array to store the readings in.
+ * @param max The number of readings there is room for in the array.
+ * @return The number of readings that were stored (the lower of max and the
+ * sensor count), or -1 on error.
+ */
+int tempered_get_readings(
+	tempered_device *device, struct tempered_reading *readings, int max
+);
+
+/** Get the times at which the current values of the given sensor were read.
+ *
+ * Sensors whose values come from the same response (e.g. the temperature and
+ * humidity of one sensor chip) share these times.
+ * @param device The device the sensor belongs to.
+ * @param sensor The ID of the sensor to get the times of.
+ * @param time Where to store the times.
+ * @return Whether or not the times were retrieved. This fails if the sensor
+ * has not been read yet.
+ * @see struct tempered_reading_time
+ */
+bool tempered_get_reading_time(
+	tempered_device *device, int sensor, struct tempered_reading_time *time
+);
+
+/** Get the raw codes that the given sensor reported in the last read.
+ *
+ * This does no conversion at all, so it is lossless, and the codes take less
+ * room to store than the values computed from them.
+ * Note that to get up-to-date codes you must first call tempered_read_sensors.
+ * @param device The device to get the raw codes from.
+ * @param sensor The ID of the sensor to get the raw codes of.
+ * @param raw Where to store the raw codes.
+ * @return Whether or not the codes were retrieved. If only some of them could
+ * be, this is true and the status of the raw reading tells which.
+ */
+bool tempered_get_raw(
+	tempered_device *device, int sensor, struct tempered_raw_reading *raw
+);
+
+/** Convert the raw temperature code of a sensor to thousandths of a degree.
+ *
+ * This uses only integer arithmetic, and gives the same values as
+ * tempered_get_temperature() (rounded to the nearest thousandth).
+ * @param raw The raw codes, as returned by tempered_get_raw().
+ * @param milli_celsius Where to store the temperature, in thousandths of a
+ * degree Celsius.
+ * @return Whether or not the temperature could be converted, which it cannot
+ * if the raw reading has no temperature code or an unknown format.
+ */
+bool tempered_raw_to_milli_celsius(
+	struct tempered_raw_reading const *raw, int *milli_celsius
+);
+
+/** Convert the raw humidity code of a sensor to thousandths of a percent.
+ *
+ * This uses only integer arithmetic, and gives the same values as
+ * tempered_get_humidity() (rounded to the nearest thousandth). Since the
+ * humidity is compensated for the temperature, the raw reading must have
+ * both a humidity and a temperature code.
+ * @param raw The raw codes, as returned by tempered_get_raw().
+ * @param milli_rel_hum Where to store the relative humidity, in thousandths
+ * of a percent.
+ * @return Whether or not the humidity could be converted.
+ */
+bool tempered_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const *raw, int *milli_rel_hum
+);
+
 /** Get the device path of the given device.
  * @param device The device to get the type name of.
  * @return The device path of the given device.
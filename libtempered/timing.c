@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "tempered.h"
+#include "tempered-internal.h"
+
+/** The default lower limit for the adaptive read timeout, in milliseconds. */
+#define TEMPERED_DEFAULT_TIMEOUT_FLOOR 50
+
+/** The default upper limit for the adaptive read timeout, in milliseconds.
+ * This is also the timeout that is used until the latency has been measured.
+ */
+#define TEMPERED_DEFAULT_TIMEOUT_CEILING 1000
+
+/** The default number of times to retry a query that has timed out. */
+#define TEMPERED_DEFAULT_RETRIES 1
+
+/** Get the current CLOCK_MONOTONIC time in nanoseconds. */
+long long tempered_monotonic_ns( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/** Get the current CLOCK_REALTIME time in nanoseconds. */
+long long tempered_realtime_ns( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_REALTIME, &now );
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/** Reset the latency statistics and timeout policy to their defaults. */
+void tempered_latency_init( struct tempered_latency *latency )
+{
+	latency->samples = 0;
+	latency->mean = 0;
+	latency->deviation = 0;
+	latency->backoff = 1;
+	latency->floor = TEMPERED_DEFAULT_TIMEOUT_FLOOR;
+	latency->ceiling = TEMPERED_DEFAULT_TIMEOUT_CEILING;
+	latency->retries = TEMPERED_DEFAULT_RETRIES;
+}
+
+/** Record a measured query round trip time for the given device. */
+void tempered_latency_sample( tempered_device *device, long long duration )
+{
+	struct tempered_latency *latency = &device->latency;
+	float sample = duration / 1000000.0f;
+	// This is the same estimator TCP uses for its retransmission timeout
+	// (RFC 6298): an EWMA of the round trip time, and of its deviation.
+	if ( latency->samples == 0 )
+	{
+		latency->mean = sample;
+		latency->deviation = sample / 2;
+	}
+	else
+	{
+		float error = sample - latency->mean;
+		latency->deviation += ( ( error < 0 ? -error : error )
+			- latency->deviation ) / 4;
+		latency->mean += error / 8;
+	}
+	latency->samples++;
+	latency->backoff = 1;
+}
+
+/** Record that a query on the given device timed out. */
+void tempered_latency_timeout( tempered_device *device )
+{
+	struct tempered_latency *latency = &device->latency;
+	if ( latency->backoff < latency->ceiling )
+	{
+		latency->backoff *= 2;
+	}
+}
+
+/** Get the current read timeout for the given device, in milliseconds. */
+int tempered_latency_get_timeout( tempered_device *device )
+{
+	struct tempered_latency *latency = &device->latency;
+	if ( latency->samples == 0 )
+	{
+		return latency->ceiling;
+	}
+	float timeout = ( latency->mean + 4 * latency->deviation )
+		* latency->backoff;
+	if ( timeout < latency->floor )
+	{
+		timeout = latency->floor;
+	}
+	if ( timeout > latency->ceiling )
+	{
+		timeout = latency->ceiling;
+	}
+	return (int) timeout;
+}
+
+/** Set the adaptive read timeout policy of the given device. */
+bool tempered_set_timeout_policy(
+	tempered_device *device, int floor, int ceiling, int retries
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	if ( floor < 0 || ceiling < floor || retries < 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INVALID_PARAMETER,
+			"invalid timeout policy", 0
+		);
+		return false;
+	}
+	tempered_lock( device );
+	device->latency.floor = floor;
+	device->latency.ceiling = ceiling;
+	device->latency.retries = retries;
+	tempered_unlock( device );
+	return true;
+}
+
+/** Get the current read timeout of the given device. */
+int tempered_get_timeout( tempered_device *device )
+{
+	if ( device == NULL )
+	{
+		return 0;
+	}
+	tempered_lock( device );
+	int timeout = tempered_latency_get_timeout( device );
+	tempered_unlock( device );
+	return timeout;
+}
+
+/** Get the measured query latency of the given device. */
+bool tempered_get_latency(
+	tempered_device *device, float *mean, float *deviation
+) {
+	if ( device == NULL )
+	{
+		return false;
+	}
+	tempered_lock( device );
+	bool result = ( device->latency.samples != 0 );
+	if ( !result )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_DATA,
+			"the latency has not been measured", 0
+		);
+	}
+	else
+	{
+		if ( mean != NULL )
+		{
+			*mean = device->latency.mean;
+		}
+		if ( deviation != NULL )
+		{
+			*deviation = device->latency.deviation;
+		}
+	}
+	tempered_unlock( device );
+	return result;
+}
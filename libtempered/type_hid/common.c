@@ -2,120 +2,246 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
-#include <hidapi.h>
+#ifdef TEMPERED_HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "common.h"
 #include "type-info.h"
 #include "internal.h"
+#include "transport.h"
+#include "fm75.h"
+#include "sht1x.h"
+#include "si7005.h"
 
 #include "../tempered.h"
 #include "../tempered-internal.h"
 
-/** Initialize the HID TEMPer types. */
-bool tempered_type_hid_init( char **error )
+/** The most stale input reports to discard before sending a query. */
+#define TEMPERED_TYPE_HID_MAX_DRAIN 16
+
+/** The largest input report that is read from a device, which is the most a
+ * full-speed USB device can send at once. This is more than a report struct
+ * holds, so that longer reports are noticed instead of being cut short.
+ */
+#define TEMPERED_TYPE_HID_READ_SIZE 64
+
+/** The transports that can be selected with tempered_set_transport. */
+static struct tempered_type_hid_transport const * const known_transports[] = {
+	// The first one of these is the default transport.
+#ifdef TEMPERED_HAVE_HIDAPI
+	&tempered_type_hid_transport_hidapi,
+#endif
+#ifdef TEMPERED_HAVE_HIDRAW
+	&tempered_type_hid_transport_hidraw,
+#endif
+	&tempered_type_hid_transport_sim,
+	NULL
+};
+
+/** The transport that is currently used for enumerating and opening. */
+static struct tempered_type_hid_transport const * current_transport = NULL;
+
+/** Select the transport with the given name (and options) without setting it.
+ * If the name is NULL, the TEMPERED_TRANSPORT environment variable is used,
+ * falling back to the default transport if that is not set either.
+ */
+static struct tempered_type_hid_transport const *
+	tempered__type_hid__select_transport( char const *name, char **error )
 {
-	if ( hid_init() != 0 )
+	if ( name == NULL )
+	{
+		name = getenv( "TEMPERED_TRANSPORT" );
+	}
+	if ( name == NULL || name[0] == '\0' )
 	{
-		if ( error != NULL )
+		name = known_transports[0]->name;
+	}
+	char const *options = strchr( name, ':' );
+	size_t name_length =
+		( options == NULL ? strlen( name ) : (size_t)( options - name ) );
+	if ( options != NULL )
+	{
+		options++;
+	}
+	int i;
+	for ( i = 0; known_transports[i] != NULL ; i++ )
+	{
+		struct tempered_type_hid_transport const *transport =
+			known_transports[i];
+		if (
+			strlen( transport->name ) != name_length ||
+			strncmp( transport->name, name, name_length ) != 0
+		) {
+			continue;
+		}
+		if ( transport->init != NULL && !transport->init( options, error ) )
 		{
-			*error = strdup( "Could not initialize the HID API." );
+			return NULL;
 		}
-		return false;
+		return transport;
+	}
+	if ( error != NULL )
+	{
+		*error = tempered_format_string(
+			"Unknown transport: %.*s", (int)name_length, name
+		);
+	}
+	return NULL;
+}
+
+#ifdef TEMPERED_HAVE_PTHREADS
+/** Guards current_transport, so that it is selected exactly once even when
+ * several threads start using the library at the same time.
+ */
+static pthread_mutex_t transport_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** Lock current_transport. */
+static void tempered__type_hid__lock_transport( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_lock( &transport_mutex );
+#endif
+}
+
+/** Unlock current_transport. */
+static void tempered__type_hid__unlock_transport( void )
+{
+#ifdef TEMPERED_HAVE_PTHREADS
+	pthread_mutex_unlock( &transport_mutex );
+#endif
+}
+
+/** Get the current transport, selecting it first if that has not been done.
+ * @return The transport, or NULL if it could not be selected.
+ */
+static struct tempered_type_hid_transport const *
+	tempered__type_hid__init_transport( char **error )
+{
+	tempered__type_hid__lock_transport();
+	if ( current_transport == NULL )
+	{
+		current_transport = tempered__type_hid__select_transport( NULL, error );
+	}
+	struct tempered_type_hid_transport const *transport = current_transport;
+	tempered__type_hid__unlock_transport();
+	return transport;
+}
+
+/** Finalize the current transport; current_transport must be locked. */
+static bool tempered__type_hid__exit_transport( char **error )
+{
+	struct tempered_type_hid_transport const *transport = current_transport;
+	current_transport = NULL;
+	if ( transport != NULL && transport->exit != NULL )
+	{
+		return transport->exit( error );
 	}
 	return true;
 }
 
+/** Initialize the HID TEMPer types. */
+bool tempered_type_hid_init( char **error )
+{
+	return tempered__type_hid__init_transport( error ) != NULL;
+}
+
 /** Finalize the HID TEMPer types. */
 bool tempered_type_hid_exit( char **error )
 {
-	if ( hid_exit() != 0 )
+	tempered__type_hid__lock_transport();
+	bool result = tempered__type_hid__exit_transport( error );
+	tempered__type_hid__unlock_transport();
+	return result;
+}
+
+/** Select the transport to use for the HID TEMPer types. */
+bool tempered_type_hid_set_transport( char const *name, char **error )
+{
+	tempered__type_hid__lock_transport();
+	bool result = tempered__type_hid__exit_transport( error );
+	if ( result )
 	{
-		if ( error != NULL )
-		{
-			*error = strdup( "Error shutting down the HID API." );
-		}
-		return false;
+		current_transport = tempered__type_hid__select_transport( name, error );
+		result = ( current_transport != NULL );
 	}
-	return true;
+	tempered__type_hid__unlock_transport();
+	return result;
+}
+
+/** Get the transport that is currently used for enumerating and opening. */
+struct tempered_type_hid_transport const * tempered_type_hid_get_transport(
+	void
+) {
+	struct tempered_type_hid_transport const *transport =
+		tempered__type_hid__init_transport( NULL );
+	if ( transport == NULL )
+	{
+		// Fall back to the default transport.
+		return known_transports[0];
+	}
+	return transport;
 }
 
 /** Enumerate the HID TEMPer devices. */
 struct tempered_device_list* tempered_type_hid_enumerate( char **error )
 {
-	struct tempered_device_list *list = NULL, *current = NULL;
-	struct hid_device_info *devs, *info;
-	devs = hid_enumerate( 0, 0 );
-	if ( devs == NULL )
-	{
-		// No HID devices were found. We unfortunately cannot know if this was
-		// because of an error or because there simply aren't any present.
-		if ( error != NULL )
-		{
-			*error = strdup( "No HID devices were found." );
-		}
+	struct tempered_type_hid_transport const *transport =
+		tempered__type_hid__init_transport( error );
+	if ( transport == NULL )
+	{
 		return NULL;
 	}
-	for ( info = devs; info; info = info->next )
+	return transport->enumerate( error );
+}
+
+/** Identify the HID device with the given path. */
+bool tempered_type_hid_identify(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+) {
+	struct tempered_type_hid_transport const *transport =
+		tempered__type_hid__init_transport( error );
+	if ( transport == NULL )
+	{
+		return false;
+	}
+	if ( transport->identify != NULL )
 	{
-		struct temper_type* type = temper_type_find(
-			info->vendor_id, info->product_id, info->interface_number
+		return transport->identify(
+			path, vendor_id, product_id, interface_number, error
 		);
-		if ( type != NULL && type->open != NULL )
+	}
+	// The transport can't look at a single device, so look for it among the
+	// enumerated ones instead.
+	struct tempered_device_list *list = transport->enumerate( error );
+	if ( list == NULL )
+	{
+		if ( error != NULL && *error == NULL )
 		{
-			#ifdef DEBUG
-			printf(
-				"Device %04hx:%04hx if %d rel %4hx | %s | %ls %ls\n",
-				info->vendor_id, info->product_id,
-				info->interface_number, info->release_number,
-				info->path,
-				info->manufacturer_string, info->product_string
-			);
-			#endif
-			struct tempered_device_list *next = malloc(
-				sizeof( struct tempered_device_list )
-			);
-			if ( next == NULL )
-			{
-				tempered_free_device_list( list );
-				if ( error != NULL )
-				{
-					*error = strdup( "Unable to allocate memory for list." );
-				}
-				return NULL;
-			}
-			
-			next->next = NULL;
-			next->path = strdup( info->path );
-			next->type_name = type->name;
-			next->vendor_id = info->vendor_id;
-			next->product_id = info->product_id;
-			next->interface_number = info->interface_number;
-			
-			if ( next->path == NULL )
-			{
-				free( next );
-				tempered_free_device_list( list );
-				if ( error != NULL )
-				{
-					*error = strdup( "Unable to allocate memory for path." );
-				}
-				return NULL;
-			}
-			
-			if ( current == NULL )
-			{
-				list = next;
-				current = list;
-			}
-			else
-			{
-				current->next = next;
-				current = current->next;
-			}
+			*error = strdup( "The device was not found." );
+		}
+		return false;
+	}
+	bool found = false;
+	int i, count = tempered_device_list_count( list );
+	for ( i = 0; i < count && !found; i++ )
+	{
+		if ( strcmp( list[i].path, path ) == 0 )
+		{
+			*vendor_id = list[i].vendor_id;
+			*product_id = list[i].product_id;
+			*interface_number = list[i].interface_number;
+			found = true;
 		}
 	}
-	hid_free_enumeration( devs );
-	return list;
+	tempered_free_device_list( list );
+	if ( !found && error != NULL )
+	{
+		*error = strdup( "The device was not found." );
+	}
+	return found;
 }
 
 bool tempered_type_hid_open( tempered_device* device )
@@ -125,17 +251,23 @@ bool tempered_type_hid_open( tempered_device* device )
 	);
 	if ( device_data == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "Failed to allocate memory for the device data." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "device data", 0
 		);
 		return false;
 	}
 	device_data->group_data = NULL;
-	device_data->hid_dev = hid_open_path( device->path );
-	if ( device_data->hid_dev == NULL )
+	device_data->own_group_data = true;
+	device_data->sensor_count = 0;
+	device_data->sensors = NULL;
+	device_data->pending_group = -1;
+	device_data->query_sent = 0;
+	device_data->group_times = NULL;
+	device_data->transport = tempered_type_hid_get_transport();
+	device_data->handle = device_data->transport->open( device, device->path );
+	if ( device_data->handle == NULL )
 	{
 		free( device_data );
-		tempered_set_error( device, strdup( "Failed to open HID device." ) );
 		return false;
 	}
 	device->data = device_data;
@@ -146,11 +278,13 @@ void tempered_type_hid_close( tempered_device* device )
 {
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
-	hid_close( device_data->hid_dev );
-	if ( device_data->group_data != NULL )
+	device_data->transport->close( device_data->handle );
+	if ( device_data->own_group_data )
 	{
-		free( device_data->group_data );
+		tempered_free_reports( device_data->group_data );
 	}
+	free( device_data->sensors );
+	free( device_data->group_times );
 	free( device_data );
 }
 
@@ -159,23 +293,86 @@ bool tempered_type_hid_subtype_open( tempered_device* device )
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
 	
-	int group_count =
-		((struct temper_subtype_hid *) device->subtype)->sensor_group_count;
+	struct temper_subtype_hid *subtype =
+		(struct temper_subtype_hid *) device->subtype;
 	
-	device_data->group_data = malloc(
-		group_count * sizeof( struct tempered_type_hid_query_result )
+	device_data->group_data = tempered_alloc_reports(
+		subtype->sensor_group_count
 	);
 	if ( device_data->group_data == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "Failed to allocate memory for the group data." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "group data", 0
 		);
 		return false;
 	}
-	int i;
-	for ( i = 0; i < group_count ; i++ )
+	
+	device_data->group_times = calloc(
+		subtype->sensor_group_count, sizeof( struct tempered_reading_time )
+	);
+	if ( device_data->group_times == NULL && subtype->sensor_group_count > 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "group times", 0
+		);
+		return false;
+	}
+	
+	// Lay the sensors of all the groups out in sensor ID order, so that the
+	// getters don't have to go through the groups to find them.
+	int group_id, count = 0;
+	for ( group_id = 0 ; group_id < subtype->sensor_group_count ; group_id++ )
+	{
+		count += subtype->sensor_groups[group_id].sensor_count;
+	}
+	device_data->sensors = malloc(
+		count * sizeof( struct tempered_type_hid_sensor_entry )
+	);
+	if ( device_data->sensors == NULL && count > 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "sensor table", 0
+		);
+		return false;
+	}
+	device_data->sensor_count = count;
+	
+	struct tempered_type_hid_sensor_entry *entry = device_data->sensors;
+	for ( group_id = 0 ; group_id < subtype->sensor_group_count ; group_id++ )
 	{
-		device_data->group_data[i].length = 0;
+		struct tempered_type_hid_sensor_group *group =
+			&subtype->sensor_groups[group_id];
+		
+		int sensor_id;
+		for ( sensor_id = 0 ; sensor_id < group->sensor_count ; sensor_id++ )
+		{
+			struct tempered_type_hid_sensor *hid_sensor =
+				&group->sensors[sensor_id];
+			
+			entry->sensor = hid_sensor;
+			entry->group = group_id;
+			entry->type = TEMPERED_SENSOR_TYPE_NONE;
+			entry->get_temperature = NULL;
+			entry->get_humidity = NULL;
+			
+			if (
+				subtype->base.get_temperature != NULL &&
+				hid_sensor->get_temperature != NULL
+			) {
+				entry->type |= TEMPERED_SENSOR_TYPE_TEMPERATURE;
+				entry->get_temperature = hid_sensor->get_temperature;
+			}
+			
+			if (
+				subtype->base.get_humidity != NULL &&
+				hid_sensor->get_humidity != NULL
+			) {
+				entry->type |= TEMPERED_SENSOR_TYPE_HUMIDITY;
+				entry->get_humidity = hid_sensor->get_humidity;
+			}
+			
+			entry++;
+		}
 	}
 	return true;
 }
@@ -194,7 +391,7 @@ bool tempered_type_hid_get_subtype_id(
 		return true;
 	}
 	
-	struct tempered_type_hid_query_result result;
+	struct tempered_report result;
 	
 	if ( !tempered_type_hid_query( device, &subtype_data->query, &result ) )
 	{
@@ -203,9 +400,7 @@ bool tempered_type_hid_get_subtype_id(
 	
 	if ( result.length <= subtype_data->id_offset )
 	{
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the device." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -229,7 +424,7 @@ bool tempered_type_hid_get_subtype_id_from_string(
 		return true;
 	}
 	
-	struct tempered_type_hid_query_result result;
+	struct tempered_report result;
 	
 	if ( !tempered_type_hid_query( device, &subtype_data->query, &result ) )
 	{
@@ -277,262 +472,872 @@ bool tempered_type_hid_get_subtype_id_from_string(
 		}
 	}
 	
-	int size = snprintf(
-		NULL, 0, "Unknown device subtype string: %s",
-		subtype_string
-	);
-	// TODO: check that size >= 0
-	size++;
-	char *error = malloc( size );
-	size = snprintf(
-		error, size, "Unknown device subtype string: %s",
-		subtype_string
+	tempered_set_error_message(
+		device, TEMPERED_ERROR_OTHER,
+		"Unknown device subtype string: %s", subtype_string
 	);
-	tempered_set_error( device, error );
 	return false;
 }
 
-bool tempered_type_hid_read_sensors( tempered_device* device )
+/** Discard any input reports that are waiting to be read from the device.
+ * These can only be late responses to earlier queries that have timed out, and
+ * would otherwise be taken to be the response to the next query.
+ */
+static bool tempered__type_hid__drain( tempered_device* device )
 {
-	struct temper_subtype_hid *subtype =
-		(struct temper_subtype_hid *) device->subtype;
-	
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
 	
+	struct tempered_report stale;
 	int i;
-	for ( i = 0; i < subtype->sensor_group_count ; i++ )
+	for ( i = 0; i < TEMPERED_TYPE_HID_MAX_DRAIN ; i++ )
 	{
-		struct tempered_type_hid_sensor_group *group =
-			&subtype->sensor_groups[i];
-		
-		struct tempered_type_hid_query_result *group_data =
-			&device_data->group_data[i];
-		
-		if ( !group->read_sensors( device, group, group_data ) )
+		int size = device_data->transport->read(
+			device, device_data->handle, stale.data, sizeof( stale.data ), 0
+		);
+		if ( size < 0 )
 		{
 			return false;
 		}
+		if ( size == 0 )
+		{
+			break;
+		}
+		device->stale_reports++;
 	}
 	return true;
 }
 
-bool tempered_type_hid_read_sensor_group(
-	tempered_device* device, struct tempered_type_hid_sensor_group* group,
-	struct tempered_type_hid_query_result* group_data
-) {
-	return tempered_type_hid_query( device, &group->query, group_data );
-}
-
-
-bool tempered_type_hid_query(
-	tempered_device* device, struct tempered_type_hid_query* query,
-	struct tempered_type_hid_query_result* result
+/** Get the times of the sensor group that the given query is for, or NULL if
+ * it is not the query of one of the device's sensor groups.
+ */
+static struct tempered_reading_time* tempered__type_hid__get_times(
+	tempered_device* device, struct tempered_type_hid_query* query
 ) {
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
 	
-	hid_device *hid_dev = device_data->hid_dev;
+	struct temper_subtype_hid *subtype =
+		(struct temper_subtype_hid *) device->subtype;
 	
-	int size;
-	if ( query->length >= 0 )
+	if ( subtype == NULL || device_data->group_times == NULL )
 	{
-		size = hid_write( hid_dev, query->data, query->length );
-		if ( size <= 0 )
+		return NULL;
+	}
+	int i;
+	for ( i = 0; i < subtype->sensor_group_count ; i++ )
+	{
+		if ( query == &subtype->sensor_groups[i].query )
 		{
-			size = snprintf(
-				NULL, 0, "HID write failed: %ls",
-				hid_error( hid_dev )
-			);
-			// TODO: check that size >= 0
-			size++;
-			char *error = malloc( size );
-			size = snprintf(
-				error, size, "HID write failed: %ls",
-				hid_error( hid_dev )
-			);
-			tempered_set_error( device, error );
-			result->length = 0;
-			return false;
+			return &device_data->group_times[i];
 		}
 	}
-	size = hid_read_timeout(
-		hid_dev, result->data, sizeof( result->data ), 1000
-	);
-	if ( size < 0 )
+	return NULL;
+}
+
+/** Record that the response for the given sensor group has been handled. */
+static void tempered__type_hid__group_completed(
+	tempered_device* device, int group_id
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	device_data->group_times[group_id].completed = tempered_monotonic_ns();
+}
+
+/** Check whether a response to either of the given queries could be taken for
+ * a response to the other one, going by their response headers.
+ */
+static bool tempered__type_hid__headers_overlap(
+	struct tempered_type_hid_query const *a,
+	struct tempered_type_hid_query const *b
+) {
+	int length = a->response_header_length;
+	if ( b->response_header_length < length )
 	{
-		size = snprintf(
-			NULL, 0, "Read of data from the sensor failed: %ls",
-			hid_error( hid_dev )
-		);
-		// TODO: check that size >= 0
-		size++;
-		char *error = malloc( size );
-		size = snprintf(
-			error, size, "Read of data from the sensor failed: %ls",
-			hid_error( hid_dev )
-		);
-		tempered_set_error( device, error );
-		result->length = 0;
-		return false;
+		length = b->response_header_length;
 	}
-	result->length = size;
-	if ( size == 0 )
+	return memcmp( a->response_header, b->response_header, length ) == 0;
+}
+
+/** Check whether the queries for all the sensor groups can be sent at once. */
+static bool tempered__type_hid__can_pipeline(
+	struct temper_subtype_hid *subtype
+) {
+	if ( subtype->serial_queries || subtype->sensor_group_count < 2 )
 	{
-		tempered_set_error(
-			device, strdup( "No data was read from the sensor (timeout)." )
-		);
 		return false;
 	}
+	int i, j;
+	for ( i = 0; i < subtype->sensor_group_count ; i++ )
+	{
+		// Unless each group's responses have a header that no other group's
+		// responses start with, a response that is lost or late could not
+		// be told apart from the next group's, and would be stored as that
+		// group's values.
+		struct tempered_type_hid_query *query =
+			&subtype->sensor_groups[i].query;
+		
+		if (
+			subtype->sensor_groups[i].read_sensors !=
+				tempered_type_hid_read_sensor_group ||
+			query->response_header_length <= 0
+		) {
+			return false;
+		}
+		for ( j = 0; j < i ; j++ )
+		{
+			if (
+				tempered__type_hid__headers_overlap(
+					query, &subtype->sensor_groups[j].query
+				)
+			) {
+				return false;
+			}
+		}
+	}
 	return true;
 }
 
-int tempered_type_hid_get_sensor_count( tempered_device* device )
+/** Write the queries for all the sensor groups without waiting for responses.
+ */
+static bool tempered__type_hid__write_all_queries( tempered_device* device )
 {
 	struct temper_subtype_hid *subtype =
 		(struct temper_subtype_hid *) device->subtype;
 	
-	int group_id, count = 0;
-	for ( group_id = 0 ; group_id < subtype->sensor_group_count ; group_id++ )
+	if ( !tempered__type_hid__drain( device ) )
 	{
-		count += subtype->sensor_groups[group_id].sensor_count;
+		return false;
 	}
-	
-	return count;
+	int i;
+	for ( i = 0; i < subtype->sensor_group_count ; i++ )
+	{
+		if (
+			!tempered_type_hid_query_write(
+				device, &subtype->sensor_groups[i].query
+			)
+		) {
+			return false;
+		}
+	}
+	return true;
 }
 
-/** Get the group and sensor numbers for the given sensor ID. */
-static bool tempered__type_hid__get_sensor_location(
-	tempered_device* device, int sensor, int* group_num, int* sensor_num
-) {
+bool tempered_type_hid_read_sensors( tempered_device* device )
+{
 	struct temper_subtype_hid *subtype =
 		(struct temper_subtype_hid *) device->subtype;
 	
-	int group_id, sensor_id = 0;
-	for ( group_id = 0 ; group_id < subtype->sensor_group_count ; group_id++ )
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	device_data->pending_group = -1;
+	int i = 0;
+	if ( tempered__type_hid__can_pipeline( subtype ) )
 	{
-		struct tempered_type_hid_sensor_group * group =
-			&subtype->sensor_groups[group_id];
-		
-		if ( sensor_id + group->sensor_count <= sensor )
+		if ( !tempered__type_hid__write_all_queries( device ) )
 		{
-			sensor_id += group->sensor_count;
-			continue;
+			return false;
+		}
+		for ( ; i < subtype->sensor_group_count ; i++ )
+		{
+			int size = tempered_type_hid_query_read(
+				device, &subtype->sensor_groups[i].query,
+				&device_data->group_data[i],
+				tempered_latency_get_timeout( device )
+			);
+			if ( size < 0 )
+			{
+				return false;
+			}
+			if ( size == 0 )
+			{
+				// Query the remaining groups one by one, with retries.
+				tempered_latency_timeout( device );
+				break;
+			}
+			tempered_latency_sample(
+				device, tempered_monotonic_ns() - device_data->query_sent
+			);
+			tempered__type_hid__group_completed( device, i );
 		}
+	}
+	for ( ; i < subtype->sensor_group_count ; i++ )
+	{
+		struct tempered_type_hid_sensor_group *group =
+			&subtype->sensor_groups[i];
 		
-		*group_num = group_id;
-		*sensor_num = sensor - sensor_id;
-		return true;
+		struct tempered_report *group_data =
+			&device_data->group_data[i];
+		
+		if ( !group->read_sensors( device, group, group_data ) )
+		{
+			return false;
+		}
+		tempered__type_hid__group_completed( device, i );
 	}
-	// The sensor ID is out of range despite the check in core.c
-	tempered_set_error(
-		device, strdup( "Sensor ID is out of range. This should never happen." )
-	);
-	return false;
+	return true;
 }
 
-int tempered_type_hid_get_sensor_type( tempered_device* device, int sensor )
+bool tempered_type_hid_read_sensors_start( tempered_device* device )
 {
-	int group_id, sensor_id;
-	if (
-		!tempered__type_hid__get_sensor_location(
-			device, sensor, &group_id, &sensor_id
-		)
-	) {
-		return TEMPERED_SENSOR_TYPE_NONE;
-	}
-	
 	struct temper_subtype_hid *subtype =
 		(struct temper_subtype_hid *) device->subtype;
 	
-	struct tempered_type_hid_sensor *hid_sensor =
-		&subtype->sensor_groups[group_id].sensors[sensor_id];
-	
-	int type = 0;
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	if (
-		subtype->base.get_temperature != NULL &&
-		hid_sensor->get_temperature != NULL
-	) {
-		type = type | TEMPERED_SENSOR_TYPE_TEMPERATURE;
+	int i;
+	for ( i = 0; i < subtype->sensor_group_count ; i++ )
+	{
+		if (
+			subtype->sensor_groups[i].read_sensors !=
+				tempered_type_hid_read_sensor_group
+		) {
+			// This group needs more than a plain query to be read.
+			tempered_set_error_code(
+				device, TEMPERED_ERROR_NOT_SUPPORTED,
+				"reading the sensors asynchronously", 0
+			);
+			return false;
+		}
 	}
 	
-	if (
-		subtype->base.get_humidity != NULL &&
-		hid_sensor->get_humidity != NULL
+	device_data->pending_group = -1;
+	if ( tempered__type_hid__can_pipeline( subtype ) )
+	{
+		if ( !tempered__type_hid__write_all_queries( device ) )
+		{
+			return false;
+		}
+	}
+	else if (
+		subtype->sensor_group_count > 0 && (
+			!tempered__type_hid__drain( device ) ||
+			!tempered_type_hid_query_write(
+				device, &subtype->sensor_groups[0].query
+			)
+		)
 	) {
-		type = type | TEMPERED_SENSOR_TYPE_HUMIDITY;
+		return false;
 	}
-	
-	return type;
+	device_data->pending_group = 0;
+	return true;
 }
 
-bool tempered_type_hid_get_temperature(
-	tempered_device* device, int sensor, float* tempC
+int tempered_type_hid_read_sensors_finish( tempered_device* device )
+{
+	struct temper_subtype_hid *subtype =
+		(struct temper_subtype_hid *) device->subtype;
+	
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	if ( device_data->pending_group < 0 )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_NOT_STARTED, NULL, 0 );
+		return TEMPERED_READ_ERROR;
+	}
+	bool pipelined = tempered__type_hid__can_pipeline( subtype );
+	while ( device_data->pending_group < subtype->sensor_group_count )
+	{
+		int group_id = device_data->pending_group;
+		int size = tempered_type_hid_query_read(
+			device, &subtype->sensor_groups[group_id].query,
+			&device_data->group_data[group_id], 0
+		);
+		if ( size < 0 )
+		{
+			device_data->pending_group = -1;
+			return TEMPERED_READ_ERROR;
+		}
+		if ( size == 0 )
+		{
+			return TEMPERED_READ_PENDING;
+		}
+		tempered_latency_sample(
+			device, tempered_monotonic_ns() - device_data->query_sent
+		);
+		tempered__type_hid__group_completed( device, group_id );
+		device_data->pending_group = ++group_id;
+		if (
+			!pipelined && group_id < subtype->sensor_group_count &&
+			!tempered_type_hid_query_write(
+				device, &subtype->sensor_groups[group_id].query
+			)
+		) {
+			device_data->pending_group = -1;
+			return TEMPERED_READ_ERROR;
+		}
+	}
+	device_data->pending_group = -1;
+	return TEMPERED_READ_DONE;
+}
+
+int tempered_type_hid_get_pollfd( tempered_device* device )
+{
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	if ( device_data->transport->get_fd == NULL )
+	{
+		return -1;
+	}
+	return device_data->transport->get_fd( device_data->handle );
+}
+
+bool tempered_type_hid_set_uring(
+	tempered_device* device, struct tempered_uring* ring
 ) {
-	int group_id, sensor_id;
-	if (
-		!tempered__type_hid__get_sensor_location(
-			device, sensor, &group_id, &sensor_id
-		)
-	) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	if ( device_data->transport->set_uring == NULL )
+	{
 		return false;
 	}
+	return device_data->transport->set_uring( device_data->handle, ring );
+}
+
+bool tempered_type_hid_get_location(
+	tempered_device* device, char* location, int size
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	struct temper_subtype_hid *subtype =
-		(struct temper_subtype_hid *) device->subtype;
+	if ( device_data->transport->get_location == NULL )
+	{
+		return false;
+	}
+	return device_data->transport->get_location(
+		device_data->handle, location, size
+	);
+}
+
+struct tempered_report* tempered_type_hid_get_reports(
+	tempered_device* device, int* count
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	struct tempered_type_hid_sensor *hid_sensor =
-		&subtype->sensor_groups[group_id].sensors[sensor_id];
+	if ( device->subtype == NULL || device_data->group_data == NULL )
+	{
+		*count = 0;
+		return NULL;
+	}
+	*count =
+		((struct temper_subtype_hid *) device->subtype)->sensor_group_count;
+	return device_data->group_data;
+}
+
+bool tempered_type_hid_set_reports(
+	tempered_device* device, struct tempered_report* reports
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	if ( hid_sensor->get_temperature == NULL )
+	if ( device_data->pending_group >= 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_BUSY, "the reports cannot be changed now", 0
+		);
+		return false;
+	}
+	int count;
+	struct tempered_report *current =
+		tempered_type_hid_get_reports( device, &count );
+	if ( current == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "This sensor cannot sense the temperature." )
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_DATA, "the device has no reports yet", 0
 		);
 		return false;
 	}
+	bool own = false;
+	if ( reports == NULL )
+	{
+		if ( device_data->own_group_data )
+		{
+			return true;
+		}
+		reports = tempered_alloc_reports( count );
+		if ( reports == NULL )
+		{
+			tempered_set_error_code(
+				device, TEMPERED_ERROR_NO_MEMORY, "group data", 0
+			);
+			return false;
+		}
+		own = true;
+	}
+	if ( reports == current )
+	{
+		return true;
+	}
+	// The transport reads straight into this array from now on, so there is
+	// no copy between the device and the caller's buffer.
+	memcpy( reports, current, count * sizeof( struct tempered_report ) );
+	if ( device_data->own_group_data )
+	{
+		tempered_free_reports( current );
+	}
+	device_data->group_data = reports;
+	device_data->own_group_data = own;
+	return true;
+}
+
+struct tempered_reading_time* tempered_type_hid_get_report_times(
+	tempered_device* device, int* count
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	if ( device->subtype == NULL || device_data->group_times == NULL )
+	{
+		*count = 0;
+		return NULL;
+	}
+	*count =
+		((struct temper_subtype_hid *) device->subtype)->sensor_group_count;
+	return device_data->group_times;
+}
+
+bool tempered_type_hid_read_sensor_group(
+	tempered_device* device, struct tempered_type_hid_sensor_group* group,
+	struct tempered_report* group_data
+) {
+	return tempered_type_hid_query( device, &group->query, group_data );
+}
+
+
+bool tempered_type_hid_query_write(
+	tempered_device* device, struct tempered_type_hid_query* query
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	struct tempered_reading_time *times =
+		tempered__type_hid__get_times( device, query );
+	
+	device_data->query_sent = tempered_monotonic_ns();
+	int size = device_data->transport->write(
+		device, device_data->handle, query->data, query->length
+	);
+	if ( size < 0 )
+	{
+		return false;
+	}
+	if ( times != NULL )
+	{
+		times->write_start = device_data->query_sent;
+		times->write_done = tempered_monotonic_ns();
+		times->response = 0;
+		times->completed = 0;
+	}
+	return true;
+}
+
+int tempered_type_hid_query_read(
+	tempered_device* device, struct tempered_type_hid_query* query,
+	struct tempered_report* result, int timeout
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	long long deadline = tempered_monotonic_ns() + timeout * 1000000LL;
+	for ( ;; )
+	{
+		unsigned char data[TEMPERED_TYPE_HID_READ_SIZE];
+		int size = device_data->transport->read(
+			device, device_data->handle, data, sizeof( data ), timeout
+		);
+		if ( size <= 0 )
+		{
+			result->length = 0;
+			return size;
+		}
+		long long now = tempered_monotonic_ns();
+		if (
+			query->response_header_length <= 0 || (
+				size >= query->response_header_length &&
+				memcmp(
+					data, query->response_header,
+					query->response_header_length
+				) == 0
+			)
+		) {
+			if ( size > (int) sizeof( result->data ) )
+			{
+				// The values could be in the part that doesn't fit.
+				tempered_set_error_code(
+					device, TEMPERED_ERROR_READ,
+					"the report is longer than TEMPERED_REPORT_SIZE", 0
+				);
+				result->length = 0;
+				return -1;
+			}
+			struct tempered_reading_time *times =
+				tempered__type_hid__get_times( device, query );
+			
+			if ( times != NULL )
+			{
+				times->response = now;
+			}
+			memcpy( result->data, data, size );
+			result->length = size;
+			return size;
+		}
+		// This is not a response to this query, so wait for the one that is.
+		device->mismatched_reports++;
+		if (
+			device_data->transport->read_again != NULL &&
+			!device_data->transport->read_again( device, device_data->handle )
+		) {
+			result->length = 0;
+			return -1;
+		}
+		if ( timeout > 0 )
+		{
+			long long left = deadline - now;
+			timeout = ( left > 0 ? (int)( left / 1000000 ) : 0 );
+		}
+	}
+}
+
+bool tempered_type_hid_query(
+	tempered_device* device, struct tempered_type_hid_query* query,
+	struct tempered_report* result
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	int attempt;
+	for ( attempt = 0; attempt <= device->latency.retries; attempt++ )
+	{
+		if (
+			query->length >= 0 && (
+				!tempered__type_hid__drain( device ) ||
+				!tempered_type_hid_query_write( device, query )
+			)
+		) {
+			result->length = 0;
+			return false;
+		}
+		int size = tempered_type_hid_query_read(
+			device, query, result, tempered_latency_get_timeout( device )
+		);
+		if ( size < 0 )
+		{
+			return false;
+		}
+		if ( size > 0 )
+		{
+			if ( query->length >= 0 )
+			{
+				tempered_latency_sample(
+					device, tempered_monotonic_ns() - device_data->query_sent
+				);
+			}
+			return true;
+		}
+		tempered_latency_timeout( device );
+	}
+	tempered_set_error_code( device, TEMPERED_ERROR_TIMEOUT, NULL, 0 );
+	return false;
+}
+
+int tempered_type_hid_get_sensor_count( tempered_device* device )
+{
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	return device_data->sensor_count;
+}
+
+/** Get the entry of the sensor table for the given sensor ID. */
+static struct tempered_type_hid_sensor_entry* tempered__type_hid__get_sensor(
+	tempered_device* device, int sensor
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	if ( sensor < 0 || sensor >= device_data->sensor_count )
+	{
+		// The sensor ID is out of range despite the check in core.c
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_INTERNAL, "sensor ID is out of range", 0
+		);
+		return NULL;
+	}
+	return &device_data->sensors[sensor];
+}
+
+int tempered_type_hid_get_sensor_type( tempered_device* device, int sensor )
+{
+	struct tempered_type_hid_sensor_entry *entry =
+		tempered__type_hid__get_sensor( device, sensor );
 	
+	if ( entry == NULL )
+	{
+		return TEMPERED_SENSOR_TYPE_NONE;
+	}
+	return entry->type;
+}
+
+int tempered_type_hid_get_readings(
+	tempered_device* device, struct tempered_reading* readings, int max
+) {
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
 	
-	struct tempered_type_hid_query_result *group_data =
-		&device_data->group_data[group_id];
+	int count = device_data->sensor_count;
+	if ( count > max )
+	{
+		count = max;
+	}
+	
+	int sensor;
+	for ( sensor = 0 ; sensor < count ; sensor++ )
+	{
+		struct tempered_type_hid_sensor_entry *entry =
+			&device_data->sensors[sensor];
+		
+		struct tempered_report *group_data =
+			&device_data->group_data[entry->group];
+		
+		struct tempered_reading *reading = &readings[sensor];
+		reading->sensor = sensor;
+		reading->type = entry->type;
+		reading->status = TEMPERED_SENSOR_TYPE_NONE;
+		reading->tempC = 0;
+		reading->rel_hum = 0;
+		
+		float value;
+		if (
+			entry->get_temperature != NULL &&
+			entry->get_temperature( device, entry->sensor, group_data, &value )
+		) {
+			reading->status |= TEMPERED_SENSOR_TYPE_TEMPERATURE;
+			reading->tempC = value;
+		}
+		
+		if (
+			entry->get_humidity != NULL &&
+			entry->get_humidity( device, entry->sensor, group_data, &value )
+		) {
+			reading->status |= TEMPERED_SENSOR_TYPE_HUMIDITY;
+			reading->rel_hum = value;
+		}
+	}
+	
+	return count;
+}
+
+bool tempered_type_hid_get_temperature(
+	tempered_device* device, int sensor, float* tempC
+) {
+	struct tempered_type_hid_sensor_entry *entry =
+		tempered__type_hid__get_sensor( device, sensor );
+	
+	if ( entry == NULL )
+	{
+		return false;
+	}
+	
+	if ( entry->get_temperature == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_SENSOR_TYPE, "sensing the temperature", 0
+		);
+		return false;
+	}
+	
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	return hid_sensor->get_temperature( device, hid_sensor, group_data, tempC );
+	return entry->get_temperature(
+		device, entry->sensor, &device_data->group_data[entry->group], tempC
+	);
 }
 
 bool tempered_type_hid_get_humidity(
 	tempered_device* device, int sensor, float* rel_hum
 ) {
-	int group_id, sensor_id;
-	if (
-		!tempered__type_hid__get_sensor_location(
-			device, sensor, &group_id, &sensor_id
-		)
-	) {
+	struct tempered_type_hid_sensor_entry *entry =
+		tempered__type_hid__get_sensor( device, sensor );
+	
+	if ( entry == NULL )
+	{
 		return false;
 	}
 	
-	struct temper_subtype_hid *subtype =
-		(struct temper_subtype_hid *) device->subtype;
+	if ( entry->get_humidity == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_SENSOR_TYPE, "sensing the humidity", 0
+		);
+		return false;
+	}
 	
-	struct tempered_type_hid_sensor *hid_sensor =
-		&subtype->sensor_groups[group_id].sensors[sensor_id];
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
 	
-	if ( hid_sensor->get_humidity == NULL )
+	return entry->get_humidity(
+		device, entry->sensor, &device_data->group_data[entry->group], rel_hum
+	);
+}
+
+bool tempered_type_hid_get_reading_time(
+	tempered_device* device, int sensor, struct tempered_reading_time* time
+) {
+	struct tempered_type_hid_device_data *device_data =
+		(struct tempered_type_hid_device_data *) device->data;
+	
+	struct tempered_type_hid_sensor_entry *entry =
+		tempered__type_hid__get_sensor( device, sensor );
+	
+	if ( entry == NULL )
 	{
-		tempered_set_error(
-			device, strdup( "This sensor cannot sense the humidity." )
-		);
 		return false;
 	}
+	struct tempered_reading_time *group_time =
+		&device_data->group_times[entry->group];
 	
+	if ( group_time->completed == 0 )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_DATA, "the sensor has not been read", 0
+		);
+		return false;
+	}
+	*time = *group_time;
+	return true;
+}
+
+/** Get the 16-bit code from the given high and low bytes of the group data.
+ * @return false if the group data is too short to hold both bytes.
+ */
+static bool tempered__type_hid__get_code(
+	struct tempered_report* group_data, int high_byte_offset,
+	int low_byte_offset, unsigned short* code
+) {
+	if (
+		group_data->length <= high_byte_offset ||
+		group_data->length <= low_byte_offset
+	) {
+		return false;
+	}
+	*code = ( ( group_data->data[high_byte_offset] & 0xFF ) << 8 )
+		| ( group_data->data[low_byte_offset] & 0xFF )
+	;
+	return true;
+}
+
+bool tempered_type_hid_get_raw(
+	tempered_device* device, int sensor, struct tempered_raw_reading* raw
+) {
 	struct tempered_type_hid_device_data *device_data =
 		(struct tempered_type_hid_device_data *) device->data;
 	
-	struct tempered_type_hid_query_result *group_data =
-		&device_data->group_data[group_id];
+	struct tempered_type_hid_sensor_entry *entry =
+		tempered__type_hid__get_sensor( device, sensor );
+	
+	if ( entry == NULL )
+	{
+		return false;
+	}
+	struct tempered_report *group_data =
+		&device_data->group_data[entry->group];
+	
+	raw->sensor = sensor;
+	raw->format = entry->sensor->raw_format;
+	raw->status = TEMPERED_SENSOR_TYPE_NONE;
+	raw->temperature = 0;
+	raw->humidity = 0;
+	
+	if (
+		( entry->type & TEMPERED_SENSOR_TYPE_TEMPERATURE ) &&
+		tempered__type_hid__get_code(
+			group_data, entry->sensor->temperature_high_byte_offset,
+			entry->sensor->temperature_low_byte_offset, &raw->temperature
+		)
+	) {
+		raw->status |= TEMPERED_SENSOR_TYPE_TEMPERATURE;
+	}
+	
+	if (
+		( entry->type & TEMPERED_SENSOR_TYPE_HUMIDITY ) &&
+		tempered__type_hid__get_code(
+			group_data, entry->sensor->humidity_high_byte_offset,
+			entry->sensor->humidity_low_byte_offset, &raw->humidity
+		)
+	) {
+		raw->status |= TEMPERED_SENSOR_TYPE_HUMIDITY;
+	}
 	
-	return hid_sensor->get_humidity( device, hid_sensor, group_data, rel_hum );
+	if ( raw->status != entry->type )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
+	}
+	return raw->status != TEMPERED_SENSOR_TYPE_NONE;
+}
+
+bool tempered_type_hid_raw_to_milli_celsius(
+	struct tempered_raw_reading const* raw, int* milli_celsius
+) {
+	if ( !( raw->status & TEMPERED_SENSOR_TYPE_TEMPERATURE ) )
+	{
+		return false;
+	}
+	switch ( raw->format )
+	{
+		case TEMPERED_RAW_FORMAT_FM75:
+			*milli_celsius =
+				tempered_type_hid_milli_celsius_fm75( raw->temperature );
+			return true;
+		case TEMPERED_RAW_FORMAT_SHT1X:
+			*milli_celsius =
+				tempered_type_hid_milli_celsius_sht1x( raw->temperature );
+			return true;
+		case TEMPERED_RAW_FORMAT_SI7005:
+			*milli_celsius =
+				tempered_type_hid_milli_celsius_si7005( raw->temperature );
+			return true;
+	}
+	return false;
+}
+
+bool tempered_type_hid_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const* raw, int* milli_rel_hum
+) {
+	int both = TEMPERED_SENSOR_TYPE_TEMPERATURE | TEMPERED_SENSOR_TYPE_HUMIDITY;
+	if ( ( raw->status & both ) != both )
+	{
+		return false;
+	}
+	switch ( raw->format )
+	{
+		case TEMPERED_RAW_FORMAT_SHT1X:
+			*milli_rel_hum = tempered_type_hid_milli_rel_hum_sht1x(
+				raw->temperature, raw->humidity
+			);
+			return true;
+		case TEMPERED_RAW_FORMAT_SI7005:
+			*milli_rel_hum = tempered_type_hid_milli_rel_hum_si7005(
+				raw->temperature, raw->humidity
+			);
+			return true;
+	}
+	return false;
+}
+
+long long tempered_type_hid_divide_rounded(
+	long long dividend, long long divisor
+) {
+	if ( dividend < 0 )
+	{
+		return -( ( -dividend + divisor / 2 ) / divisor );
+	}
+	return ( dividend + divisor / 2 ) / divisor;
 }
@@ -10,9 +10,18 @@ bool tempered_type_hid_init( char **error );
 /** Finalize the HID TEMPer types. */
 bool tempered_type_hid_exit( char **error );
 
+/** Select the transport to use for the HID TEMPer types. */
+bool tempered_type_hid_set_transport( char const *name, char **error );
+
 /** Enumerate the HID TEMPer devices. */
 struct tempered_device_list* tempered_type_hid_enumerate( char **error );
 
+/** Identify the HID device with the given path. */
+bool tempered_type_hid_identify(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+);
+
 /** Method for opening HID devices. */
 bool tempered_type_hid_open( tempered_device* device );
 
@@ -41,10 +50,80 @@ int tempered_type_hid_get_sensor_type( tempered_device* device, int sensor );
 /** Method for reading the sensors on a HID device. */
 bool tempered_type_hid_read_sensors( tempered_device* device );
 
+/** Method for starting to read the sensors on a HID device. */
+bool tempered_type_hid_read_sensors_start( tempered_device* device );
+
+/** Method for continuing a read of the sensors on a HID device. */
+int tempered_type_hid_read_sensors_finish( tempered_device* device );
+
+/** Method for getting the file descriptor to poll for a HID device. */
+int tempered_type_hid_get_pollfd( tempered_device* device );
+
+/** Method for attaching a HID device to an io_uring (or detaching it). */
+bool tempered_type_hid_set_uring(
+	tempered_device* device, struct tempered_uring* ring
+);
+
+/** Method for getting the array of group data reports of a HID device. */
+struct tempered_report* tempered_type_hid_get_reports(
+	tempered_device* device, int* count
+);
+
+/** Method for making a HID device store its group data in the given array. */
+bool tempered_type_hid_set_reports(
+	tempered_device* device, struct tempered_report* reports
+);
+
+/** Method for getting the array of the times the groups of a HID device were
+ * read at.
+ */
+struct tempered_reading_time* tempered_type_hid_get_report_times(
+	tempered_device* device, int* count
+);
+
+/** Method for getting the values of all the sensors of a HID device. */
+int tempered_type_hid_get_readings(
+	tempered_device* device, struct tempered_reading* readings, int max
+);
+
+/** Method for getting the location that a HID device is attached at. */
+bool tempered_type_hid_get_location(
+	tempered_device* device, char* location, int size
+);
+
+/** Method for getting the times at which a HID device's sensor was read. */
+bool tempered_type_hid_get_reading_time(
+	tempered_device* device, int sensor, struct tempered_reading_time* time
+);
+
+/** Method for getting the raw codes that a HID device's sensor reported. */
+bool tempered_type_hid_get_raw(
+	tempered_device* device, int sensor, struct tempered_raw_reading* raw
+);
+
+/** Convert the raw temperature code of a HID sensor to thousandths of a degree.
+ */
+bool tempered_type_hid_raw_to_milli_celsius(
+	struct tempered_raw_reading const* raw, int* milli_celsius
+);
+
+/** Convert the raw humidity code of a HID sensor to thousandths of a percent.
+ */
+bool tempered_type_hid_raw_to_milli_rel_hum(
+	struct tempered_raw_reading const* raw, int* milli_rel_hum
+);
+
+/** Divide the given numbers, rounding the result to the nearest integer (away
+ * from zero if it is halfway). The divisor must be positive.
+ */
+long long tempered_type_hid_divide_rounded(
+	long long dividend, long long divisor
+);
+
 /** Method for reading data from the device for a given sensor group. */
 bool tempered_type_hid_read_sensor_group(
 	tempered_device* device, struct tempered_type_hid_sensor_group* group,
-	struct tempered_type_hid_query_result* group_data
+	struct tempered_report* group_data
 );
 
 /** Method for getting the temperature from HID devices. */
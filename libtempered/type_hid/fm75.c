@@ -2,19 +2,18 @@
 #include <string.h>
 
 #include "type-info.h"
+#include "common.h"
 #include "../tempered-internal.h"
 
 bool tempered_type_hid_get_temperature_fm75(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *tempC
+	struct tempered_report *group_data, float *tempC
 ) {
 	if (
 		group_data->length <= sensor->temperature_high_byte_offset ||
 		group_data->length <= sensor->temperature_low_byte_offset
 	) {
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the sensor." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -33,3 +32,10 @@ bool tempered_type_hid_get_temperature_fm75(
 	
 	return true;
 }
+
+int tempered_type_hid_milli_celsius_fm75( unsigned short code )
+{
+	// The same formula as above, on the code as the 16-bit two's complement
+	// number that the two data bytes make up.
+	return tempered_type_hid_divide_rounded( (signed short)code * 125LL, 32 );
+}
@@ -7,7 +7,10 @@
 
 bool tempered_type_hid_get_temperature_fm75(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *tempC
+	struct tempered_report *group_data, float *tempC
 );
 
+/** Convert a raw FM75 temperature code to thousandths of a degree Celsius. */
+int tempered_type_hid_milli_celsius_fm75( unsigned short code );
+
 #endif
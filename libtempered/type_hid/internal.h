@@ -1,25 +1,101 @@
 #ifndef TEMPERED__TYPE_HID__INTERNAL_H
 #define TEMPERED__TYPE_HID__INTERNAL_H
 
-#include <hidapi.h>
-
 #include "common.h"
 #include "type-info.h"
+#include "transport.h"
+
+/** This struct describes one sensor of an opened device, so that it can be
+ * found directly by its sensor ID instead of by going through the groups.
+ */
+struct tempered_type_hid_sensor_entry
+{
+	/** The sensor this entry describes. */
+	struct tempered_type_hid_sensor *sensor;
+	
+	/** The method used to get the temperature from the sensor group's data,
+	 * or NULL if the sensor or its subtype does not support temperature.
+	 */
+	bool (*get_temperature)(
+		tempered_device*, struct tempered_type_hid_sensor*,
+		struct tempered_report*, float*
+	);
+	
+	/** The method used to get the humidity from the sensor group's data,
+	 * or NULL if the sensor or its subtype does not support humidity.
+	 */
+	bool (*get_humidity)(
+		tempered_device*, struct tempered_type_hid_sensor*,
+		struct tempered_report*, float*
+	);
+	
+	/** The index of the sensor group the sensor is in. */
+	int group;
+	
+	/** The type of the sensor, made up of the TEMPERED_SENSOR_TYPE_* constants.
+	 */
+	int type;
+};
 
 /** The struct that is stored in device->data for this type of device. */
 struct tempered_type_hid_device_data
 {
-	/** Handle for the HID device. */
-	hid_device *hid_dev;
+	/** The transport that is used to talk to the HID device. */
+	struct tempered_type_hid_transport const *transport;
+	
+	/** The transport-specific handle for the HID device. */
+	void *handle;
 	
 	/** Array of groups of data that has been read from the device. */
-	struct tempered_type_hid_query_result *group_data;
+	struct tempered_report *group_data;
+	
+	/** Whether group_data was allocated by us, rather than by the caller. */
+	bool own_group_data;
+	
+	/** The number of sensors the device has, counted when it was opened. */
+	int sensor_count;
+	
+	/** Array of sensor_count entries describing the device's sensors, in
+	 * sensor ID order.
+	 */
+	struct tempered_type_hid_sensor_entry *sensors;
+	
+	/** The sensor group that a started read is waiting for, or -1 if no read
+	 * has been started.
+	 */
+	int pending_group;
+	
+	/** When the last query was written to the device (CLOCK_MONOTONIC ns). */
+	long long query_sent;
+	
+	/** Array of the times at which each sensor group was last read, or NULL
+	 * if the subtype has not been opened yet.
+	 */
+	struct tempered_reading_time *group_times;
 };
 
-/** Perform a HID query on the given device. */
+/** Send the given HID query to the device without reading the response. */
+bool tempered_type_hid_query_write(
+	tempered_device* device, struct tempered_type_hid_query* query
+);
+
+/** Read the response to a HID query, waiting for at most timeout ms.
+ * Reports that don't start with the query's response header are discarded.
+ * @return The number of bytes read, 0 if nothing was read before the timeout,
+ * or -1 on error (in which case the device error is set).
+ */
+int tempered_type_hid_query_read(
+	tempered_device* device, struct tempered_type_hid_query* query,
+	struct tempered_report* result, int timeout
+);
+
+/** Perform a HID query on the given device.
+ * The response is waited for with the device's adaptive timeout, and the query
+ * is sent again on timeout as many times as the device's policy allows.
+ */
 bool tempered_type_hid_query(
 	tempered_device* device, struct tempered_type_hid_query* query,
-	struct tempered_type_hid_query_result* result
+	struct tempered_report* result
 );
 
 #endif
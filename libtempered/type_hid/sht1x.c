@@ -2,19 +2,18 @@
 #include <string.h>
 
 #include "type-info.h"
+#include "common.h"
 #include "../tempered-internal.h"
 
 bool tempered_type_hid_get_temperature_sht1x(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *tempC
+	struct tempered_report *group_data, float *tempC
 ) {
 	if (
 		group_data->length <= sensor->temperature_high_byte_offset ||
 		group_data->length <= sensor->temperature_low_byte_offset
 	) {
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the sensor." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -38,7 +37,7 @@ bool tempered_type_hid_get_temperature_sht1x(
 
 bool tempered_type_hid_get_humidity_sht1x(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *rel_hum
+	struct tempered_report *group_data, float *rel_hum
 ) {
 	float tempC;
 	if (
@@ -54,9 +53,7 @@ bool tempered_type_hid_get_humidity_sht1x(
 		group_data->length <= sensor->humidity_low_byte_offset
 	)
 	{
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the sensor." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -80,3 +77,30 @@ bool tempered_type_hid_get_humidity_sht1x(
 	
 	return true;
 }
+
+int tempered_type_hid_milli_celsius_sht1x( unsigned short code )
+{
+	// The same formula as above, in thousandths of a degree.
+	return -39700 + 10 * (signed short)code;
+}
+
+int tempered_type_hid_milli_rel_hum_sht1x(
+	unsigned short temperature_code, unsigned short humidity_code
+) {
+	long long temp = tempered_type_hid_milli_celsius_sht1x( temperature_code );
+	long long rh = humidity_code;
+	
+	// The same formulas as above, in units of 1e-10 %RH so that all of their
+	// coefficients are integers.
+	long long relhum = -20468000000LL + 367000000LL * rh - 15955 * rh * rh;
+	relhum += ( temp - 25000 ) * ( 100000 + 800 * rh );
+	
+	int milli_rel_hum =
+		tempered_type_hid_divide_rounded( relhum, 10000000LL );
+	
+	// Clamp the numbers to a sensible range, as per the datasheet.
+	if ( milli_rel_hum <= 0 ) milli_rel_hum = 0;
+	if ( milli_rel_hum > 99000 ) milli_rel_hum = 100000;
+	
+	return milli_rel_hum;
+}
@@ -2,19 +2,18 @@
 #include <string.h>
 
 #include "type-info.h"
+#include "common.h"
 #include "../tempered-internal.h"
 
 bool tempered_type_hid_get_temperature_si7005(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *tempC
+	struct tempered_report *group_data, float *tempC
 ) {
 	if (
 		group_data->length <= sensor->temperature_high_byte_offset ||
 		group_data->length <= sensor->temperature_low_byte_offset
 	) {
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the sensor." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -35,7 +34,7 @@ bool tempered_type_hid_get_temperature_si7005(
 
 bool tempered_type_hid_get_humidity_si7005(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *rel_hum
+	struct tempered_report *group_data, float *rel_hum
 ) {
 	float tempC;
 	if (
@@ -51,9 +50,7 @@ bool tempered_type_hid_get_humidity_si7005(
 		group_data->length <= sensor->humidity_low_byte_offset
 	)
 	{
-		tempered_set_error(
-			device, strdup( "Not enough data was read from the sensor." )
-		);
+		tempered_set_error_code( device, TEMPERED_ERROR_SHORT_READ, NULL, 0 );
 		return false;
 	}
 	
@@ -78,3 +75,37 @@ bool tempered_type_hid_get_humidity_si7005(
 	
 	return true;
 }
+
+int tempered_type_hid_milli_celsius_si7005( unsigned short code )
+{
+	// The same formula as above, in thousandths of a degree.
+	return tempered_type_hid_divide_rounded( code * 125LL, 4 ) - 50000;
+}
+
+int tempered_type_hid_milli_rel_hum_si7005(
+	unsigned short temperature_code, unsigned short humidity_code
+) {
+	long long temp = tempered_type_hid_milli_celsius_si7005( temperature_code );
+	
+	// The same formulas as above, on the code as the number of 1/16 %RH above
+	// -24%RH, in units of 1e-7 %RH / 256 so that all of the coefficients are
+	// integers (and then in units of 1e-7 %RH).
+	long long rh = humidity_code - 384;
+	
+	// Linearization
+	long long relhum = tempered_type_hid_divide_rounded(
+		160000000LL * rh + 39300 * rh * rh - 64128000LL * rh + 12248064000LL,
+		256
+	);
+	
+	// Temperature compensation (divided in two steps, so that it cannot
+	// overflow even for codes that are far out of range)
+	long long factor = tempered_type_hid_divide_rounded(
+		237 * relhum + 197300000000LL, 10000
+	);
+	relhum += tempered_type_hid_divide_rounded(
+		( temp - 30000 ) * factor, 10000
+	);
+	
+	return tempered_type_hid_divide_rounded( relhum, 10000 );
+}
@@ -9,12 +9,22 @@
 
 bool tempered_type_hid_get_temperature_si7005(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *tempC
+	struct tempered_report *group_data, float *tempC
 );
 
 bool tempered_type_hid_get_humidity_si7005(
 	tempered_device *device, struct tempered_type_hid_sensor *sensor,
-	struct tempered_type_hid_query_result *group_data, float *rel_hum
+	struct tempered_report *group_data, float *rel_hum
+);
+
+/** Convert a raw Si7005 temperature code to thousandths of a degree Celsius. */
+int tempered_type_hid_milli_celsius_si7005( unsigned short code );
+
+/** Convert a raw Si7005 humidity code to thousandths of a percent, using the
+ * raw temperature code for the temperature compensation.
+ */
+int tempered_type_hid_milli_rel_hum_si7005(
+	unsigned short temperature_code, unsigned short humidity_code
 );
 
 #endif
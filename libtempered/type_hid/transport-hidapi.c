@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <hidapi.h>
+
+#include "transport.h"
+#include "common.h"
+
+#include "../tempered.h"
+#include "../tempered-internal.h"
+#include "../temper_type.h"
+
+/** Initialize the HIDAPI library. */
+static bool tempered_type_hid_hidapi_init( char const *options, char **error )
+{
+	if ( options != NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "The hidapi transport does not take options." );
+		}
+		return false;
+	}
+	if ( hid_init() != 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not initialize the HID API." );
+		}
+		return false;
+	}
+	return true;
+}
+
+/** Finalize the HIDAPI library. */
+static bool tempered_type_hid_hidapi_exit( char **error )
+{
+	if ( hid_exit() != 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Error shutting down the HID API." );
+		}
+		return false;
+	}
+	return true;
+}
+
+/** Enumerate the HID TEMPer devices that HIDAPI can find. */
+static struct tempered_device_list* tempered_type_hid_hidapi_enumerate(
+	char **error
+) {
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	unsigned short vendor_id, product_id;
+	int i;
+	// Only ask about the known devices, so that HIDAPI doesn't have to look
+	// into every keyboard, UPS and virtual HID device on the system.
+	for ( i = 0; temper_type_get_ids( i, &vendor_id, &product_id ); i++ )
+	{
+		struct hid_device_info *devs, *info;
+		devs = hid_enumerate( vendor_id, product_id );
+		for ( info = devs; info; info = info->next )
+		{
+			struct temper_type* type = temper_type_find(
+				info->vendor_id, info->product_id, info->interface_number
+			);
+			if ( type == NULL || type->open == NULL )
+			{
+				continue;
+			}
+			#ifdef DEBUG
+			printf(
+				"Device %04hx:%04hx if %d rel %4hx | %s | %ls %ls\n",
+				info->vendor_id, info->product_id,
+				info->interface_number, info->release_number,
+				info->path,
+				info->manufacturer_string, info->product_string
+			);
+			#endif
+			if (
+				!tempered_device_list_builder_add(
+					&builder, info->path, type->name, info->vendor_id,
+					info->product_id, info->interface_number
+				)
+			) {
+				hid_free_enumeration( devs );
+				tempered_device_list_builder_free( &builder );
+				if ( error != NULL )
+				{
+					*error = strdup( "Unable to allocate memory for list." );
+				}
+				return NULL;
+			}
+		}
+		hid_free_enumeration( devs );
+	}
+	return tempered_device_list_builder_finish( &builder, false, error );
+}
+
+/** Open the HID device with the given path. */
+static void* tempered_type_hid_hidapi_open(
+	tempered_device *device, char const *path
+) {
+	hid_device *hid_dev = hid_open_path( path );
+	if ( hid_dev == NULL )
+	{
+		tempered_set_error( device, strdup( "Failed to open HID device." ) );
+		return NULL;
+	}
+	return hid_dev;
+}
+
+/** Close the given HID device. */
+static void tempered_type_hid_hidapi_close( void *handle )
+{
+	hid_close( (hid_device *) handle );
+}
+
+/** Write an output report to the given HID device. */
+static int tempered_type_hid_hidapi_write(
+	tempered_device *device, void *handle,
+	unsigned char const *data, int length
+) {
+	hid_device *hid_dev = (hid_device *) handle;
+	int size = hid_write( hid_dev, data, length );
+	if ( size <= 0 )
+	{
+		// The message from HIDAPI may not outlive the next call on the device,
+		// so it is formatted right away (without allocating anything).
+		tempered_set_error_message(
+			device, TEMPERED_ERROR_WRITE, "HID write failed: %ls",
+			hid_error( hid_dev )
+		);
+		return -1;
+	}
+	return size;
+}
+
+/** Read an input report from the given HID device. */
+static int tempered_type_hid_hidapi_read(
+	tempered_device *device, void *handle,
+	unsigned char *data, int length, int timeout
+) {
+	hid_device *hid_dev = (hid_device *) handle;
+	int size = hid_read_timeout( hid_dev, data, length, timeout );
+	if ( size < 0 )
+	{
+		// The message from HIDAPI may not outlive the next call on the device,
+		// so it is formatted right away (without allocating anything).
+		tempered_set_error_message(
+			device, TEMPERED_ERROR_READ, "Read of data from the sensor failed: %ls",
+			hid_error( hid_dev )
+		);
+		return -1;
+	}
+	return size;
+}
+
+struct tempered_type_hid_transport const tempered_type_hid_transport_hidapi = {
+	.name = "hidapi",
+	.init = tempered_type_hid_hidapi_init,
+	.exit = tempered_type_hid_hidapi_exit,
+	.enumerate = tempered_type_hid_hidapi_enumerate,
+	.open = tempered_type_hid_hidapi_open,
+	.close = tempered_type_hid_hidapi_close,
+	.write = tempered_type_hid_hidapi_write,
+	.read = tempered_type_hid_hidapi_read
+};
@@ -0,0 +1,1081 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "transport.h"
+#include "common.h"
+
+#include "../tempered.h"
+#include "../tempered-internal.h"
+#include "../temper_type.h"
+#ifdef TEMPERED_HAVE_IO_URING
+#include <stddef.h>
+#include "../uring.h"
+#endif
+
+/** The directory that holds the hidraw device nodes. */
+#define HIDRAW_DEV_DIR "/dev"
+
+/** The default root of the sysfs tree that describes the hidraw devices. */
+#define HIDRAW_SYSFS_ROOT "/sys"
+
+/** The directory under the sysfs root that holds the hidraw devices. */
+#define HIDRAW_SYSFS_CLASS "/class/hidraw"
+
+/** The most of a device's sysfs uevent data that is looked at. */
+#define HIDRAW_UEVENT_SIZE 1024
+
+/** The longest sysfs root that can be given with the sysfs option. */
+#define HIDRAW_SYSFS_ROOT_MAX 1024
+
+/** The largest report that is read from or written to a device. */
+#define HIDRAW_REPORT_SIZE 64
+
+/** The most late responses to throw away before queuing a query on a ring. */
+#define HIDRAW_MAX_DRAIN 16
+
+/** The number of queries that are allocated when a device is attached to a
+ * ring, which is enough for reading the sensor groups of any subtype without
+ * allocating more of them.
+ */
+#define HIDRAW_URING_QUERIES 8
+
+/** The handle for an opened hidraw device. */
+struct tempered_type_hid_hidraw_device
+{
+	/** The file descriptor of the opened device node. */
+	int fd;
+
+#ifdef TEMPERED_HAVE_IO_URING
+	/** The io_uring that queries are queued on instead of being written
+	 * directly, or NULL if the device is not attached to one.
+	 */
+	struct tempered_uring *ring;
+	
+	/** The first of the queries that were queued on the ring, in order. */
+	struct hidraw_uring_query *first_query;
+	
+	/** The last of the queries that were queued on the ring. */
+	struct hidraw_uring_query *last_query;
+	
+	/** The queries that are not in use, which are reused for new queries. */
+	struct hidraw_uring_query *free_queries;
+	
+	/** All the queries that were allocated for the device. */
+	struct hidraw_uring_query *all_queries;
+#endif
+};
+
+
+/** Format the given message followed by strerror(errnum) as an error. */
+static char* hidraw_format_error( char const *message, int errnum )
+{
+	char buffer[TEMPERED_STRERROR_SIZE];
+	char const *text = tempered_strerror_r( errnum, buffer, sizeof( buffer ) );
+	return tempered_format_string( "%s: %s", message, text );
+}
+
+#ifdef TEMPERED_HAVE_IO_URING
+
+/** A query that was queued on an io_uring as a chain of a write of the query,
+ * a read of the response, and a timeout for the read.
+ *
+ * The kernel owns the buffers until all three operations have completed, so
+ * the query is only reused once that has happened and it has been taken off
+ * its device's list (or the device has forgotten about it). If the device has
+ * been closed by then, the query is freed instead.
+ */
+struct hidraw_uring_query
+{
+	/** The operation that writes the query. */
+	struct tempered_uring_op write_op;
+	
+	/** The operation that reads the response. */
+	struct tempered_uring_op read_op;
+	
+	/** The operation that times out the read. */
+	struct tempered_uring_op timeout_op;
+	
+	/** The device the query belongs to, or NULL if it has been closed. */
+	struct tempered_type_hid_hidraw_device *owner;
+	
+	/** The next query on the device's list, or on its free list. */
+	struct hidraw_uring_query *next;
+	
+	/** The next query that was allocated for the same device. */
+	struct hidraw_uring_query *next_allocated;
+	
+	/** The number of operations that have not yet completed. */
+	int pending;
+	
+	/** Whether the query is still on its device's list. */
+	bool listed;
+	
+	/** Whether the read of the response has completed. */
+	bool read_done;
+	
+	/** The submission batch of the ring that the query was queued in. */
+	unsigned int batch;
+	
+	/** The result of the write, as a negative errno value on failure. */
+	int write_result;
+	
+	/** The result of the read, as a negative errno value on failure. */
+	int read_result;
+	
+	/** How long to wait for the response. */
+	struct __kernel_timespec timeout;
+	
+	/** The query that is written to the device. */
+	unsigned char data[HIDRAW_REPORT_SIZE];
+	
+	/** The buffer the response is read into. */
+	unsigned char response[HIDRAW_REPORT_SIZE];
+};
+
+/** Put the query back on its device's free list if the kernel and the device
+ * are both done with it, or free it if the device has been closed.
+ */
+static void hidraw_uring_release( struct hidraw_uring_query *query )
+{
+	if ( query->pending != 0 || query->listed )
+	{
+		return;
+	}
+	if ( query->owner == NULL )
+	{
+		free( query );
+		return;
+	}
+	query->next = query->owner->free_queries;
+	query->owner->free_queries = query;
+}
+
+/** Allocate a query for the device and put it on its free list.
+ * @return Whether or not it could be allocated.
+ */
+static bool hidraw_uring_allocate(
+	struct tempered_type_hid_hidraw_device *hidraw
+) {
+	struct hidraw_uring_query *query = malloc(
+		sizeof( struct hidraw_uring_query )
+	);
+	if ( query == NULL )
+	{
+		return false;
+	}
+	query->owner = hidraw;
+	query->pending = 0;
+	query->listed = false;
+	query->next_allocated = hidraw->all_queries;
+	hidraw->all_queries = query;
+	hidraw_uring_release( query );
+	return true;
+}
+
+/** Free the device's queries that are not in use, and leave the others to be
+ * freed once the kernel is done with them; the device must have forgotten
+ * about all of its queries.
+ */
+static void hidraw_uring_free_all(
+	struct tempered_type_hid_hidraw_device *hidraw
+) {
+	struct hidraw_uring_query *query = hidraw->all_queries;
+	while ( query != NULL )
+	{
+		struct hidraw_uring_query *next = query->next_allocated;
+		query->owner = NULL;
+		if ( query->pending == 0 )
+		{
+			free( query );
+		}
+		query = next;
+	}
+	hidraw->all_queries = NULL;
+	hidraw->free_queries = NULL;
+}
+
+/** Handle the completion of the write of a query. */
+static void hidraw_uring_write_done( struct tempered_uring_op *op, int result )
+{
+	struct hidraw_uring_query *query = (struct hidraw_uring_query *)
+		( (char *) op - offsetof( struct hidraw_uring_query, write_op ) );
+	query->write_result = result;
+	query->pending--;
+	hidraw_uring_release( query );
+}
+
+/** Handle the completion of the read of a query's response. */
+static void hidraw_uring_read_done( struct tempered_uring_op *op, int result )
+{
+	struct hidraw_uring_query *query = (struct hidraw_uring_query *)
+		( (char *) op - offsetof( struct hidraw_uring_query, read_op ) );
+	query->read_result = result;
+	query->read_done = true;
+	query->pending--;
+	hidraw_uring_release( query );
+}
+
+/** Handle the completion of the timeout of a query's read. */
+static void hidraw_uring_timeout_done(
+	struct tempered_uring_op *op, int result
+) {
+	struct hidraw_uring_query *query = (struct hidraw_uring_query *)
+		( (char *) op - offsetof( struct hidraw_uring_query, timeout_op ) );
+	(void) result;
+	query->pending--;
+	hidraw_uring_release( query );
+}
+
+/** Take the first query off the device's list. */
+static struct hidraw_uring_query* hidraw_uring_pop(
+	struct tempered_type_hid_hidraw_device *hidraw
+) {
+	struct hidraw_uring_query *query = hidraw->first_query;
+	hidraw->first_query = query->next;
+	if ( hidraw->first_query == NULL )
+	{
+		hidraw->last_query = NULL;
+	}
+	query->listed = false;
+	return query;
+}
+
+/** Forget about the queries on the device's list whose batch is not the given
+ * one, or all of them if all is true; their responses will be thrown away.
+ */
+static void hidraw_uring_forget(
+	struct tempered_type_hid_hidraw_device *hidraw, bool all,
+	unsigned int batch
+) {
+	while (
+		hidraw->first_query != NULL &&
+		( all || hidraw->first_query->batch != batch )
+	) {
+		hidraw_uring_release( hidraw_uring_pop( hidraw ) );
+	}
+}
+
+/** Throw away the input reports that are waiting on the device node, which
+ * are late responses to queries whose reads have already timed out.
+ * The reads that are queued on the ring would otherwise take these instead of
+ * the responses to their own queries.
+ */
+static bool hidraw_uring_drain(
+	tempered_device *device, struct tempered_type_hid_hidraw_device *hidraw
+) {
+	unsigned char stale[HIDRAW_REPORT_SIZE];
+	int i;
+	for ( i = 0; i < HIDRAW_MAX_DRAIN; i++ )
+	{
+		struct pollfd pfd = { .fd = hidraw->fd, .events = POLLIN };
+		int ready, size = 0;
+		do
+		{
+			ready = poll( &pfd, 1, 0 );
+		}
+		while ( ready < 0 && errno == EINTR );
+		if ( ready > 0 && ( pfd.revents & POLLIN ) )
+		{
+			do
+			{
+				size = read( hidraw->fd, stale, sizeof( stale ) );
+			}
+			while ( size < 0 && errno == EINTR );
+		}
+		if ( ready < 0 || size < 0 )
+		{
+			tempered_set_error_code( device, TEMPERED_ERROR_READ, NULL, errno );
+			return false;
+		}
+		if ( size == 0 )
+		{
+			// Nothing is waiting (or the device is gone, which the queued
+			// operations will report).
+			return true;
+		}
+		device->stale_reports++;
+	}
+	return true;
+}
+
+/** Get a new query for the device's io_uring, with room reserved on the ring
+ * for the given number of operations.
+ * @return The query, or NULL if that failed (with the device error set).
+ */
+static struct hidraw_uring_query* hidraw_uring_new_query(
+	tempered_device *device, struct tempered_type_hid_hidraw_device *hidraw,
+	int error_code, unsigned int operations
+) {
+	// The queries are only allocated here if all the ones that were
+	// allocated in advance are still in use.
+	if ( hidraw->free_queries == NULL && !hidraw_uring_allocate( hidraw ) )
+	{
+		tempered_set_error_code( device, error_code, NULL, ENOMEM );
+		return NULL;
+	}
+	if ( !tempered_uring_reserve( hidraw->ring, operations ) )
+	{
+		tempered_set_error_code( device, error_code, NULL, errno );
+		return NULL;
+	}
+	struct hidraw_uring_query *query = hidraw->free_queries;
+	hidraw->free_queries = query->next;
+	// The batch changes if reserving had to submit the earlier queries.
+	query->batch = tempered_uring_get_batch( hidraw->ring );
+	int timeout = tempered_uring_get_timeout( hidraw->ring );
+	query->timeout.tv_sec = timeout / 1000;
+	query->timeout.tv_nsec = ( timeout % 1000 ) * 1000000LL;
+	query->write_result = 0;
+	query->read_result = -ECANCELED;
+	query->pending = operations;
+	query->listed = true;
+	query->read_done = false;
+	query->next = NULL;
+	query->write_op.complete = hidraw_uring_write_done;
+	query->read_op.complete = hidraw_uring_read_done;
+	query->timeout_op.complete = hidraw_uring_timeout_done;
+	return query;
+}
+
+/** Queue the read of a query's response and its timeout on the io_uring. */
+static void hidraw_uring_queue_read(
+	struct tempered_type_hid_hidraw_device *hidraw,
+	struct hidraw_uring_query *query
+) {
+	struct io_uring_sqe *sqe;
+	sqe = tempered_uring_queue( hidraw->ring, &query->read_op );
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = hidraw->fd;
+	sqe->addr = (unsigned long long)(uintptr_t) query->response;
+	sqe->len = HIDRAW_REPORT_SIZE;
+	sqe->off = -1;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe = tempered_uring_queue( hidraw->ring, &query->timeout_op );
+	sqe->opcode = IORING_OP_LINK_TIMEOUT;
+	sqe->addr = (unsigned long long)(uintptr_t) &query->timeout;
+	sqe->len = 1;
+}
+
+/** Queue a query on the device's io_uring. */
+static int hidraw_uring_write(
+	tempered_device *device, struct tempered_type_hid_hidraw_device *hidraw,
+	unsigned char const *data, int length
+) {
+	unsigned int batch = tempered_uring_get_batch( hidraw->ring );
+	// Queries from earlier batches are still listed only if they timed out,
+	// and this is a retry, so their late responses are not wanted anymore.
+	hidraw_uring_forget( hidraw, false, batch );
+	if ( length > HIDRAW_REPORT_SIZE )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_WRITE, NULL, ENOMEM );
+		return -1;
+	}
+	// Only the first query of a batch drains the device node, since the
+	// reports that come in after that may be responses to this batch.
+	if ( hidraw->first_query == NULL && !hidraw_uring_drain( device, hidraw ) )
+	{
+		return -1;
+	}
+	struct hidraw_uring_query *query = hidraw_uring_new_query(
+		device, hidraw, TEMPERED_ERROR_WRITE, 3
+	);
+	if ( query == NULL )
+	{
+		return -1;
+	}
+	memcpy( query->data, data, length );
+	
+	struct io_uring_sqe *sqe;
+	sqe = tempered_uring_queue( hidraw->ring, &query->write_op );
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = hidraw->fd;
+	sqe->addr = (unsigned long long)(uintptr_t) query->data;
+	sqe->len = length;
+	sqe->off = -1;
+	sqe->flags = IOSQE_IO_LINK;
+	hidraw_uring_queue_read( hidraw, query );
+	
+	if ( hidraw->last_query == NULL )
+	{
+		hidraw->first_query = query;
+	}
+	else
+	{
+		hidraw->last_query->next = query;
+	}
+	hidraw->last_query = query;
+	return length;
+}
+
+/** Queue another read for the response to the query whose response was just
+ * taken, in front of the other queries on the device's list.
+ */
+static bool hidraw_uring_read_again(
+	tempered_device *device, struct tempered_type_hid_hidraw_device *hidraw
+) {
+	struct hidraw_uring_query *query = hidraw_uring_new_query(
+		device, hidraw, TEMPERED_ERROR_READ, 2
+	);
+	if ( query == NULL )
+	{
+		return false;
+	}
+	// It belongs with the queries that were queued along with the one it
+	// reads for, so that retrying those forgets this one as well.
+	if ( hidraw->first_query != NULL )
+	{
+		query->batch = hidraw->first_query->batch;
+	}
+	hidraw_uring_queue_read( hidraw, query );
+	
+	query->next = hidraw->first_query;
+	hidraw->first_query = query;
+	if ( hidraw->last_query == NULL )
+	{
+		hidraw->last_query = query;
+	}
+	return true;
+}
+
+/** Get the response to the first query that was queued on the io_uring. */
+static int hidraw_uring_read(
+	tempered_device *device, struct tempered_type_hid_hidraw_device *hidraw,
+	unsigned char *data, int length
+) {
+	struct hidraw_uring_query *query = hidraw->first_query;
+	if ( query == NULL || !query->read_done )
+	{
+		return 0;
+	}
+	hidraw_uring_pop( hidraw );
+	int write_result = query->write_result, size = query->read_result;
+	if ( size > 0 )
+	{
+		if ( size > length )
+		{
+			size = length;
+		}
+		memcpy( data, query->response, size );
+	}
+	hidraw_uring_release( query );
+	if ( write_result < 0 && write_result != -ECANCELED )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_WRITE, NULL, -write_result
+		);
+		return -1;
+	}
+	if ( size == -ECANCELED || size == -EINTR || size == -ETIME )
+	{
+		// The read was cancelled by its timeout.
+		return 0;
+	}
+	if ( size < 0 )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_READ, NULL, -size );
+		return -1;
+	}
+	return size;
+}
+
+#endif
+
+/** Get the USB IDs and interface number of the given hidraw device node.
+ * The interface number is taken from the physical location string, which for
+ * USB devices ends with "/input" followed by the interface number.
+ */
+static bool hidraw_get_info(
+	int fd, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number
+) {
+	struct hidraw_devinfo info;
+	char phys[256];
+	if ( ioctl( fd, HIDIOCGRAWINFO, &info ) < 0 )
+	{
+		return false;
+	}
+	int length = ioctl( fd, HIDIOCGRAWPHYS( sizeof( phys ) ), phys );
+	if ( length < 0 )
+	{
+		return false;
+	}
+	phys[ length < (int)sizeof( phys ) ? length : (int)sizeof( phys ) - 1 ] =
+		'\0';
+	char const *input = strrchr( phys, '/' );
+	if ( input == NULL || sscanf( input, "/input%d", interface_number ) != 1 )
+	{
+		*interface_number = 0;
+	}
+	*vendor_id = info.vendor;
+	*product_id = info.product;
+	return true;
+}
+
+/** The root of the sysfs tree that the hidraw devices are looked up in. */
+static char hidraw_sysfs_root[HIDRAW_SYSFS_ROOT_MAX] = HIDRAW_SYSFS_ROOT;
+
+/** Initialize the hidraw transport with the given options. */
+static bool tempered_type_hid_hidraw_init( char const *options, char **error )
+{
+	char const *root = HIDRAW_SYSFS_ROOT;
+	int root_length = strlen( root );
+	char const *pos = options;
+	while ( pos != NULL && pos[0] != '\0' )
+	{
+		char const *end = strchr( pos, ',' );
+		if ( end == NULL )
+		{
+			end = pos + strlen( pos );
+		}
+		if ( end - pos > 6 && strncmp( pos, "sysfs=", 6 ) == 0 )
+		{
+			root = pos + 6;
+			root_length = end - root;
+		}
+		else
+		{
+			root_length = -1;
+		}
+		if ( root_length < 0 || root_length >= HIDRAW_SYSFS_ROOT_MAX )
+		{
+			if ( error != NULL )
+			{
+				*error = tempered_format_string(
+					"Invalid hidraw option: %.*s", (int)( end - pos ), pos
+				);
+			}
+			return false;
+		}
+		pos = ( end[0] == ',' ? end + 1 : end );
+	}
+	memcpy( hidraw_sysfs_root, root, root_length );
+	hidraw_sysfs_root[root_length] = '\0';
+	return true;
+}
+
+/** Read the USB IDs and interface number of a hidraw device from its sysfs
+ * uevent data, which can be done without opening the device node itself.
+ * The interface number is taken from HID_PHYS, the same way as with the
+ * physical location string in hidraw_get_info().
+ * @return Whether or not the device's USB IDs were found.
+ */
+static bool hidraw_read_uevent(
+	char const *name, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number
+) {
+	char path[HIDRAW_SYSFS_ROOT_MAX + sizeof( HIDRAW_SYSFS_CLASS ) + 256 + 16];
+	snprintf(
+		path, sizeof( path ), "%s%s/%s/device/uevent",
+		hidraw_sysfs_root, HIDRAW_SYSFS_CLASS, name
+	);
+	// This is read into a buffer on the stack instead of with stdio, so that
+	// enumerating doesn't allocate anything for devices that aren't ours.
+	int fd = open( path, O_RDONLY | O_CLOEXEC );
+	if ( fd < 0 )
+	{
+		return false;
+	}
+	char uevent[HIDRAW_UEVENT_SIZE];
+	int length = read( fd, uevent, sizeof( uevent ) - 1 );
+	close( fd );
+	if ( length <= 0 )
+	{
+		return false;
+	}
+	uevent[length] = '\0';
+	bool found = false;
+	*interface_number = 0;
+	char *line, *next;
+	for ( line = uevent; line != NULL; line = next )
+	{
+		next = strchr( line, '\n' );
+		if ( next != NULL )
+		{
+			*next++ = '\0';
+		}
+		unsigned int bus, vendor, product;
+		if (
+			sscanf( line, "HID_ID=%x:%x:%x", &bus, &vendor, &product ) == 3
+		) {
+			*vendor_id = vendor;
+			*product_id = product;
+			found = true;
+		}
+		else if ( strncmp( line, "HID_PHYS=", 9 ) == 0 )
+		{
+			char const *input = strrchr( line, '/' );
+			if (
+				input == NULL ||
+				sscanf( input, "/input%d", interface_number ) != 1
+			) {
+				*interface_number = 0;
+			}
+		}
+	}
+	return found;
+}
+
+/** Check the USB IDs of a hidraw device in its sysfs uevent data.
+ * @return false if the device is known not to be one of ours, true if it
+ * might be (including when the uevent data could not be read).
+ */
+static bool hidraw_might_be_known( char const *name )
+{
+	unsigned short vendor_id, product_id;
+	int interface_number;
+	if (
+		!hidraw_read_uevent(
+			name, &vendor_id, &product_id, &interface_number
+		)
+	) {
+		return true;
+	}
+	return temper_type_is_known( vendor_id, product_id );
+}
+
+/** Add the hidraw device node with the given name to a device list.
+ * @return Whether or not there was memory for it.
+ */
+static bool hidraw_add_list_entry(
+	struct tempered_device_list_builder *builder, char const *name,
+	struct temper_type *type, unsigned short vendor_id,
+	unsigned short product_id, int interface_number
+) {
+	char path[sizeof( HIDRAW_DEV_DIR ) + 256];
+	snprintf( path, sizeof( path ), "%s/%s", HIDRAW_DEV_DIR, name );
+	return tempered_device_list_builder_add(
+		builder, path, type->name, vendor_id, product_id, interface_number
+	);
+}
+
+/** Check whether the given device node name is that of a hidraw node. */
+static bool hidraw_filter_name( char const *name )
+{
+	return strncmp( name, "hidraw", 6 ) == 0;
+}
+
+/** Filter for scandir() that only accepts hidraw device nodes. */
+static int hidraw_filter( struct dirent const *entry )
+{
+	return hidraw_filter_name( entry->d_name );
+}
+
+/** Identify the hidraw device node with the given name (e.g. "hidraw0"). */
+bool tempered_type_hid_hidraw_identify(
+	char const *name, struct tempered_device_list_builder *builder
+) {
+	if ( !hidraw_might_be_known( name ) )
+	{
+		return true;
+	}
+	char path[sizeof( HIDRAW_DEV_DIR ) + 256];
+	snprintf( path, sizeof( path ), "%s/%s", HIDRAW_DEV_DIR, name );
+	int fd = open( path, O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+	if ( fd < 0 )
+	{
+		// Most likely a device we have no permission to use.
+		return true;
+	}
+	unsigned short vendor_id, product_id;
+	int interface_number;
+	bool found = hidraw_get_info(
+		fd, &vendor_id, &product_id, &interface_number
+	);
+	close( fd );
+	if ( !found )
+	{
+		return true;
+	}
+	struct temper_type* type = temper_type_find(
+		vendor_id, product_id, interface_number
+	);
+	if ( type == NULL || type->open == NULL )
+	{
+		return true;
+	}
+	return hidraw_add_list_entry(
+		builder, name, type, vendor_id, product_id, interface_number
+	);
+}
+
+/** Identify the hidraw device node with the given path.
+ * For the nodes in /dev this is done with the sysfs uevent data when that is
+ * available, and otherwise by opening the node and asking it.
+ */
+static bool tempered_type_hid_hidraw_identify_path(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+) {
+	char const *name = path + sizeof( HIDRAW_DEV_DIR );
+	if (
+		strncmp( path, HIDRAW_DEV_DIR "/", sizeof( HIDRAW_DEV_DIR ) ) == 0 &&
+		strchr( name, '/' ) == NULL && hidraw_filter_name( name ) &&
+		hidraw_read_uevent( name, vendor_id, product_id, interface_number )
+	) {
+		return true;
+	}
+	int fd = open( path, O_RDONLY | O_NONBLOCK | O_CLOEXEC );
+	if ( fd < 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = hidraw_format_error( "Failed to open HID device", errno );
+		}
+		return false;
+	}
+	bool found = hidraw_get_info(
+		fd, vendor_id, product_id, interface_number
+	);
+	int errnum = errno;
+	close( fd );
+	if ( !found )
+	{
+		if ( error != NULL )
+		{
+			*error = hidraw_format_error(
+				"Failed to get the HID device information", errnum
+			);
+		}
+		return false;
+	}
+	return true;
+}
+
+/** Enumerate the HID TEMPer devices by opening each hidraw device node.
+ * This is only used when sysfs is not available.
+ */
+static struct tempered_device_list* hidraw_enumerate_nodes( char **error )
+{
+	struct dirent **entries;
+	int count = scandir(
+		HIDRAW_DEV_DIR, &entries, hidraw_filter, alphasort
+	);
+	if ( count <= 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "No HID devices were found." );
+		}
+		return NULL;
+	}
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	bool ok = true;
+	int i;
+	for ( i = 0; i < count; i++ )
+	{
+		ok = ok && tempered_type_hid_hidraw_identify(
+			entries[i]->d_name, &builder
+		);
+		free( entries[i] );
+	}
+	free( entries );
+	if ( !ok )
+	{
+		tempered_device_list_builder_free( &builder );
+		if ( error != NULL )
+		{
+			*error = strdup( "Unable to allocate memory for list." );
+		}
+		return NULL;
+	}
+	return tempered_device_list_builder_finish( &builder, false, error );
+}
+
+/** Enumerate the HID TEMPer devices by walking the hidraw devices in sysfs.
+ * This only reads their uevent files, without opening any device nodes, so
+ * devices that cannot be opened (e.g. for lack of permission) are included.
+ */
+static struct tempered_device_list* tempered_type_hid_hidraw_enumerate(
+	char **error
+) {
+	char path[HIDRAW_SYSFS_ROOT_MAX + sizeof( HIDRAW_SYSFS_CLASS )];
+	snprintf(
+		path, sizeof( path ), "%s%s", hidraw_sysfs_root, HIDRAW_SYSFS_CLASS
+	);
+	DIR *dir = opendir( path );
+	if ( dir == NULL )
+	{
+		return hidraw_enumerate_nodes( error );
+	}
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	struct dirent *entry;
+	while ( ( entry = readdir( dir ) ) != NULL )
+	{
+		unsigned short vendor_id, product_id;
+		int interface_number;
+		if (
+			!hidraw_filter( entry ) ||
+			!hidraw_read_uevent(
+				entry->d_name, &vendor_id, &product_id, &interface_number
+			)
+		) {
+			continue;
+		}
+		struct temper_type* type = temper_type_find(
+			vendor_id, product_id, interface_number
+		);
+		if ( type == NULL || type->open == NULL )
+		{
+			continue;
+		}
+		if (
+			!hidraw_add_list_entry(
+				&builder, entry->d_name, type, vendor_id, product_id,
+				interface_number
+			)
+		) {
+			closedir( dir );
+			tempered_device_list_builder_free( &builder );
+			if ( error != NULL )
+			{
+				*error = strdup( "Unable to allocate memory for list." );
+			}
+			return NULL;
+		}
+	}
+	closedir( dir );
+	// Sort the list by path, like the node scan does, so that the order does
+	// not depend on the order of the directory entries.
+	return tempered_device_list_builder_finish( &builder, true, error );
+}
+
+/** Open the hidraw device node with the given path. */
+static void* tempered_type_hid_hidraw_open(
+	tempered_device *device, char const *path
+) {
+	struct tempered_type_hid_hidraw_device *hidraw = malloc(
+		sizeof( struct tempered_type_hid_hidraw_device )
+	);
+	if ( hidraw == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "device", 0
+		);
+		return NULL;
+	}
+#ifdef TEMPERED_HAVE_IO_URING
+	hidraw->ring = NULL;
+	hidraw->first_query = NULL;
+	hidraw->last_query = NULL;
+	hidraw->free_queries = NULL;
+	hidraw->all_queries = NULL;
+#endif
+	hidraw->fd = open( path, O_RDWR | O_CLOEXEC );
+	if ( hidraw->fd < 0 )
+	{
+		tempered_set_error(
+			device, hidraw_format_error( "Failed to open HID device", errno )
+		);
+		free( hidraw );
+		return NULL;
+	}
+	return hidraw;
+}
+
+/** Close the given hidraw device. */
+static void tempered_type_hid_hidraw_close( void *handle )
+{
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+#ifdef TEMPERED_HAVE_IO_URING
+	hidraw_uring_forget( hidraw, true, 0 );
+	hidraw_uring_free_all( hidraw );
+#endif
+	close( hidraw->fd );
+	free( hidraw );
+}
+
+/** Write an output report to the given hidraw device. */
+static int tempered_type_hid_hidraw_write(
+	tempered_device *device, void *handle,
+	unsigned char const *data, int length
+) {
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+#ifdef TEMPERED_HAVE_IO_URING
+	if ( hidraw->ring != NULL )
+	{
+		return hidraw_uring_write( device, hidraw, data, length );
+	}
+#endif
+	int size;
+	do
+	{
+		size = write( hidraw->fd, data, length );
+	}
+	while ( size < 0 && errno == EINTR );
+	if ( size <= 0 )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_WRITE, NULL, errno );
+		return -1;
+	}
+	return size;
+}
+
+/** Read an input report from the given hidraw device. */
+static int tempered_type_hid_hidraw_read(
+	tempered_device *device, void *handle,
+	unsigned char *data, int length, int timeout
+) {
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+#ifdef TEMPERED_HAVE_IO_URING
+	if ( hidraw->ring != NULL )
+	{
+		// The responses are read by the ring, so there is nothing to wait for.
+		return hidraw_uring_read( device, hidraw, data, length );
+	}
+#endif
+	struct pollfd pfd = { .fd = hidraw->fd, .events = POLLIN };
+	int ready;
+	do
+	{
+		ready = poll( &pfd, 1, timeout );
+	}
+	while ( ready < 0 && errno == EINTR );
+	if ( ready < 0 )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_READ, NULL, errno );
+		return -1;
+	}
+	if ( ready == 0 )
+	{
+		return 0;
+	}
+	if ( pfd.revents & ( POLLERR | POLLHUP | POLLNVAL ) )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_READ, NULL, ENODEV );
+		return -1;
+	}
+	int size;
+	do
+	{
+		size = read( hidraw->fd, data, length );
+	}
+	while ( size < 0 && errno == EINTR );
+	if ( size < 0 )
+	{
+		tempered_set_error_code( device, TEMPERED_ERROR_READ, NULL, errno );
+		return -1;
+	}
+	return size;
+}
+
+/** Get the file descriptor of the given hidraw device. */
+static int tempered_type_hid_hidraw_get_fd( void *handle )
+{
+	return ( (struct tempered_type_hid_hidraw_device *) handle )->fd;
+}
+
+/** Get the physical location of the given hidraw device, followed by its
+ * serial number if it has one.
+ */
+static bool tempered_type_hid_hidraw_get_location(
+	void *handle, char *location, int size
+) {
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+	char phys[256], uniq[256];
+	int length = ioctl( hidraw->fd, HIDIOCGRAWPHYS( sizeof( phys ) ), phys );
+	if ( length <= 0 )
+	{
+		return false;
+	}
+	phys[ length < (int)sizeof( phys ) ? length : (int)sizeof( phys ) - 1 ] =
+		'\0';
+	uniq[0] = '\0';
+#ifdef HIDIOCGRAWUNIQ
+	// Not all kernels know this one, and most of these devices have no serial.
+	length = ioctl( hidraw->fd, HIDIOCGRAWUNIQ( sizeof( uniq ) ), uniq );
+	if ( length > 0 )
+	{
+		uniq[ length < (int)sizeof( uniq ) ? length : (int)sizeof( uniq ) - 1 ] =
+			'\0';
+	}
+	else
+	{
+		uniq[0] = '\0';
+	}
+#endif
+	length = snprintf(
+		location, size, "%s%s%s", phys, ( uniq[0] != '\0' ? "@" : "" ), uniq
+	);
+	return length > 0 && length < size;
+}
+
+/** Make sure another input report is read from the given hidraw device. */
+static bool tempered_type_hid_hidraw_read_again(
+	tempered_device *device, void *handle
+) {
+#ifdef TEMPERED_HAVE_IO_URING
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+	if ( hidraw->ring != NULL )
+	{
+		return hidraw_uring_read_again( device, hidraw );
+	}
+#else
+	(void) device;
+	(void) handle;
+#endif
+	// Without a ring, each read waits for the next report by itself.
+	return true;
+}
+
+#ifdef TEMPERED_HAVE_IO_URING
+/** Attach the given hidraw device to an io_uring, or detach it (if NULL). */
+static bool tempered_type_hid_hidraw_set_uring(
+	void *handle, struct tempered_uring *ring
+) {
+	struct tempered_type_hid_hidraw_device *hidraw =
+		(struct tempered_type_hid_hidraw_device *) handle;
+	hidraw_uring_forget( hidraw, true, 0 );
+	hidraw->ring = NULL;
+	// Allocate the queries now, so that reading the device does not have to.
+	int count = 0;
+	struct hidraw_uring_query *query;
+	for ( query = hidraw->all_queries; query != NULL; )
+	{
+		count++;
+		query = query->next_allocated;
+	}
+	for ( ; ring != NULL && count < HIDRAW_URING_QUERIES; count++ )
+	{
+		if ( !hidraw_uring_allocate( hidraw ) )
+		{
+			return false;
+		}
+	}
+	hidraw->ring = ring;
+	return true;
+}
+#endif
+
+struct tempered_type_hid_transport const tempered_type_hid_transport_hidraw = {
+	.name = "hidraw",
+	.init = tempered_type_hid_hidraw_init,
+	.enumerate = tempered_type_hid_hidraw_enumerate,
+	.identify = tempered_type_hid_hidraw_identify_path,
+	.open = tempered_type_hid_hidraw_open,
+	.close = tempered_type_hid_hidraw_close,
+	.write = tempered_type_hid_hidraw_write,
+	.read = tempered_type_hid_hidraw_read,
+	.read_again = tempered_type_hid_hidraw_read_again,
+	.get_fd = tempered_type_hid_hidraw_get_fd,
+	.get_location = tempered_type_hid_hidraw_get_location,
+#ifdef TEMPERED_HAVE_IO_URING
+	.set_uring = tempered_type_hid_hidraw_set_uring
+#endif
+};
@@ -0,0 +1,727 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "transport.h"
+#include "common.h"
+#include "type-info.h"
+#include "fm75.h"
+
+#include "../tempered.h"
+#include "../tempered-internal.h"
+#include "../temper_type.h"
+
+/** The size of the reports that the simulated devices send back. */
+#define SIM_REPORT_LENGTH 8
+
+/** How many responses a simulated device can have queued up. */
+#define SIM_QUEUE_LENGTH 16
+
+/** The configuration that the simulated devices are created from. */
+struct tempered_type_hid_sim_config
+{
+	/** How many simulated devices to enumerate. */
+	int device_count;
+	
+	/** The type of the simulated devices. */
+	struct temper_type *type;
+	
+	/** The subtype ID that the simulated devices report. */
+	unsigned char subtype_id;
+	
+	/** The response to send back for sensor group queries. */
+	unsigned char data[SIM_REPORT_LENGTH];
+	
+	/** The minimum time it takes for a response to arrive, in milliseconds. */
+	double latency;
+	
+	/** The maximum random extra time before a response arrives. */
+	double jitter;
+	
+	/** The probability that a write or read fails with an error. */
+	double fail_rate;
+	
+	/** The probability that a query is never answered. */
+	double drop_rate;
+	
+	/** The base random seed for the simulated devices. */
+	unsigned int seed;
+};
+
+/** A response that a simulated device has queued up to be read. */
+struct tempered_type_hid_sim_response
+{
+	/** When the response becomes readable, in CLOCK_MONOTONIC nanoseconds. */
+	long long ready;
+	
+	/** The data of the response. */
+	unsigned char data[SIM_REPORT_LENGTH];
+};
+
+/** The handle for an opened simulated device. */
+struct tempered_type_hid_sim_device
+{
+	/** The state of this device's random number generator. */
+	unsigned int seed;
+	
+	/** A timer that becomes readable when the first queued response is ready,
+	 * or -1 if timers are not supported on this system.
+	 */
+	int fd;
+	
+	/** The index of the first queued response. */
+	int queue_start;
+	
+	/** The number of queued responses. */
+	int queue_count;
+	
+	/** The queued responses, as a ring buffer. */
+	struct tempered_type_hid_sim_response queue[SIM_QUEUE_LENGTH];
+};
+
+static struct tempered_type_hid_sim_config sim_config;
+
+/** The simulated pipelined device type. It is like the HidTEMPer2, except that
+ * each response starts with the command byte of its query, like the responses
+ * of the other TEMPer types do.
+ */
+struct temper_type tempered_type_hid_sim_type = {
+	.name = "Simulated TEMPer2 (pipelined)",
+	.vendor_id = TEMPERED_TYPE_HID_SIM_VENDOR_ID,
+	.product_id = TEMPERED_TYPE_HID_SIM_PRODUCT_ID,
+	.interface_number = 0,
+	.open = tempered_type_hid_open,
+	.close = tempered_type_hid_close,
+	.get_pollfd = tempered_type_hid_get_pollfd,
+	.set_uring = tempered_type_hid_set_uring,
+	.get_reports = tempered_type_hid_get_reports,
+	.set_reports = tempered_type_hid_set_reports,
+	.get_report_times = tempered_type_hid_get_report_times,
+	.get_location = tempered_type_hid_get_location,
+	.get_reading_time = tempered_type_hid_get_reading_time,
+	.get_raw = tempered_type_hid_get_raw,
+	.subtypes = (struct temper_subtype*[]){
+		(struct temper_subtype*)&(struct temper_subtype_hid){
+			.base = {
+				.id = 0,
+				.name = "Simulated TEMPer2 (pipelined)",
+				.open = tempered_type_hid_subtype_open,
+				.read_sensors = tempered_type_hid_read_sensors,
+				.read_sensors_start = tempered_type_hid_read_sensors_start,
+				.read_sensors_finish = tempered_type_hid_read_sensors_finish,
+				.get_readings = tempered_type_hid_get_readings,
+				.get_sensor_count = tempered_type_hid_get_sensor_count,
+				.get_temperature = tempered_type_hid_get_temperature
+			},
+			.sensor_group_count = 2,
+			.sensor_groups = (struct tempered_type_hid_sensor_group[]){
+				{ // Internal sensor
+					.query = {
+						.length = 9,
+						.data = (unsigned char[]){ 0, 0x54, 0, 0, 0, 0, 0, 0, 0 },
+						.response_header_length = 1,
+						.response_header = (unsigned char[]){ 0x54 }
+					},
+					.read_sensors = tempered_type_hid_read_sensor_group,
+					.sensor_count = 1,
+					.sensors = (struct tempered_type_hid_sensor[]){
+						{
+							.get_temperature = tempered_type_hid_get_temperature_fm75,
+							.temperature_high_byte_offset = 2,
+							.temperature_low_byte_offset = 3,
+							.raw_format = TEMPERED_RAW_FORMAT_FM75
+						}
+					}
+				},
+				{ // External sensor
+					.query = {
+						.length = 9,
+						.data = (unsigned char[]){ 0, 0x53, 0, 0, 0, 0, 0, 0, 0 },
+						.response_header_length = 1,
+						.response_header = (unsigned char[]){ 0x53 }
+					},
+					.read_sensors = tempered_type_hid_read_sensor_group,
+					.sensor_count = 1,
+					.sensors = (struct tempered_type_hid_sensor[]){
+						{
+							.get_temperature = tempered_type_hid_get_temperature_fm75,
+							.temperature_high_byte_offset = 2,
+							.temperature_low_byte_offset = 3,
+							.raw_format = TEMPERED_RAW_FORMAT_FM75
+						}
+					}
+				}
+			}
+		},
+		NULL // List terminator for subtypes
+	}
+};
+
+/** Get the current CLOCK_MONOTONIC time in nanoseconds. */
+static long long sim_now( void )
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/** Sleep until the given CLOCK_MONOTONIC time in nanoseconds. */
+static void sim_sleep_until( long long until )
+{
+	long long now = sim_now();
+	if ( until <= now )
+	{
+		return;
+	}
+	struct timespec delay = {
+		.tv_sec = ( until - now ) / 1000000000LL,
+		.tv_nsec = ( until - now ) % 1000000000LL
+	};
+	while ( nanosleep( &delay, &delay ) != 0 )
+	{
+		// Interrupted by a signal; keep sleeping for the remaining time.
+	}
+}
+
+/** Get a random number between 0 and 1 for the given device. */
+static double sim_random( struct tempered_type_hid_sim_device *sim )
+{
+	return rand_r( &sim->seed ) / ( (double)RAND_MAX + 1 );
+}
+
+/** Parse a string of hex bytes (optionally separated by colons) into data. */
+static bool sim_parse_data( char const *value, int length, unsigned char *data )
+{
+	int count = 0, i = 0;
+	memset( data, 0, SIM_REPORT_LENGTH );
+	while ( i < length )
+	{
+		if ( value[i] == ':' )
+		{
+			i++;
+			continue;
+		}
+		unsigned int byte;
+		if (
+			count >= SIM_REPORT_LENGTH || i + 1 >= length ||
+			!isxdigit( (unsigned char) value[i] ) ||
+			!isxdigit( (unsigned char) value[i + 1] ) ||
+			sscanf( &value[i], "%2x", &byte ) != 1
+		) {
+			return false;
+		}
+		data[count++] = byte;
+		i += 2;
+	}
+	return count > 0;
+}
+
+/** Find the type with the given USB IDs that is not ignored. */
+static struct temper_type* sim_find_type(
+	unsigned short vendor_id, unsigned short product_id
+) {
+	int interface_number;
+	for ( interface_number = 0; interface_number < 16; interface_number++ )
+	{
+		struct temper_type *type = temper_type_find(
+			vendor_id, product_id, interface_number
+		);
+		if ( type != NULL && type->open != NULL )
+		{
+			return type;
+		}
+	}
+	return NULL;
+}
+
+/** Parse the simulation options given to tempered_set_transport. */
+static bool tempered_type_hid_sim_init( char const *options, char **error )
+{
+	struct tempered_type_hid_sim_config config = {
+		.device_count = 1,
+		.type = temper_type_find( 0x0c45, 0x7401, 1 ),
+		.data = { 0x80, 0x02, 0x16, 0x80, 0x05, 0xdc, 0x16, 0x80 },
+		.latency = 0,
+		.jitter = 0,
+		.fail_rate = 0,
+		.drop_rate = 0,
+		.seed = 1
+	};
+	bool subtype_given = false;
+	char const *pos = options;
+	while ( pos != NULL && pos[0] != '\0' )
+	{
+		char const *value = strchr( pos, '=' );
+		char const *end = strchr( pos, ',' );
+		if ( end == NULL )
+		{
+			end = pos + strlen( pos );
+		}
+		bool ok = ( value != NULL && value < end );
+		if ( ok )
+		{
+			int key_length = value - pos;
+			value++;
+			unsigned int vendor_id, product_id;
+			int interface_number = -1;
+			char *parse_end = NULL;
+			if ( key_length == 7 && strncmp( pos, "devices", 7 ) == 0 )
+			{
+				config.device_count = strtol( value, &parse_end, 10 );
+				ok = ( config.device_count >= 0 );
+			}
+			else if ( key_length == 4 && strncmp( pos, "type", 4 ) == 0 )
+			{
+				int fields = sscanf(
+					value, "%4x:%4x:%d",
+					&vendor_id, &product_id, &interface_number
+				);
+				config.type = NULL;
+				if ( fields == 3 )
+				{
+					config.type = temper_type_find(
+						vendor_id, product_id, interface_number
+					);
+				}
+				else if ( fields == 2 )
+				{
+					config.type = sim_find_type( vendor_id, product_id );
+				}
+				ok = ( config.type != NULL && config.type->open != NULL );
+				parse_end = (char *) end;
+			}
+			else if ( key_length == 7 && strncmp( pos, "subtype", 7 ) == 0 )
+			{
+				config.subtype_id = strtol( value, &parse_end, 0 );
+				subtype_given = true;
+			}
+			else if ( key_length == 4 && strncmp( pos, "data", 4 ) == 0 )
+			{
+				ok = sim_parse_data( value, end - value, config.data );
+				parse_end = (char *) end;
+			}
+			else if ( key_length == 7 && strncmp( pos, "latency", 7 ) == 0 )
+			{
+				config.latency = strtod( value, &parse_end );
+				ok = ( config.latency >= 0 );
+			}
+			else if ( key_length == 6 && strncmp( pos, "jitter", 6 ) == 0 )
+			{
+				config.jitter = strtod( value, &parse_end );
+				ok = ( config.jitter >= 0 );
+			}
+			else if ( key_length == 4 && strncmp( pos, "fail", 4 ) == 0 )
+			{
+				config.fail_rate = strtod( value, &parse_end );
+				ok = ( config.fail_rate >= 0 && config.fail_rate <= 1 );
+			}
+			else if ( key_length == 4 && strncmp( pos, "drop", 4 ) == 0 )
+			{
+				config.drop_rate = strtod( value, &parse_end );
+				ok = ( config.drop_rate >= 0 && config.drop_rate <= 1 );
+			}
+			else if ( key_length == 4 && strncmp( pos, "seed", 4 ) == 0 )
+			{
+				config.seed = strtoul( value, &parse_end, 0 );
+			}
+			else
+			{
+				ok = false;
+			}
+			ok = ok && parse_end == end;
+		}
+		if ( !ok )
+		{
+			if ( error != NULL )
+			{
+				*error = tempered_format_string(
+					"Invalid simulation option: %.*s", (int)( end - pos ), pos
+				);
+			}
+			return false;
+		}
+		pos = ( end[0] == ',' ? end + 1 : end );
+	}
+	if ( !subtype_given )
+	{
+		config.subtype_id = config.type->subtypes[0]->id;
+	}
+	sim_config = config;
+	return true;
+}
+
+/** Enumerate the simulated devices. */
+static struct tempered_device_list* tempered_type_hid_sim_enumerate(
+	char **error
+) {
+	if ( sim_config.type == NULL && !tempered_type_hid_sim_init( NULL, error ) )
+	{
+		return NULL;
+	}
+	struct tempered_device_list_builder builder;
+	tempered_device_list_builder_init( &builder );
+	int i;
+	for ( i = 0; i < sim_config.device_count; i++ )
+	{
+		char path[32];
+		snprintf( path, sizeof( path ), "sim:%d", i );
+		if (
+			!tempered_device_list_builder_add(
+				&builder, path, sim_config.type->name,
+				sim_config.type->vendor_id, sim_config.type->product_id,
+				sim_config.type->interface_number
+			)
+		) {
+			tempered_device_list_builder_free( &builder );
+			if ( error != NULL )
+			{
+				*error = strdup( "Unable to allocate memory for list." );
+			}
+			return NULL;
+		}
+	}
+	return tempered_device_list_builder_finish( &builder, false, error );
+}
+
+/** Get the index of the simulated device with the given path.
+ * @return The index, or -1 if there is no such simulated device.
+ */
+static long sim_parse_path( char const *path )
+{
+	char *end = NULL;
+	long index = -1;
+	if ( strncmp( path, "sim:", 4 ) == 0 )
+	{
+		index = strtol( path + 4, &end, 10 );
+	}
+	if ( sim_config.type == NULL && !tempered_type_hid_sim_init( NULL, NULL ) )
+	{
+		return -1;
+	}
+	if ( index < 0 || index >= sim_config.device_count || *end != '\0' )
+	{
+		return -1;
+	}
+	return index;
+}
+
+/** Identify the simulated device with the given path. */
+static bool tempered_type_hid_sim_identify(
+	char const *path, unsigned short *vendor_id, unsigned short *product_id,
+	int *interface_number, char **error
+) {
+	if ( sim_parse_path( path ) < 0 )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "No such simulated device." );
+		}
+		return false;
+	}
+	*vendor_id = sim_config.type->vendor_id;
+	*product_id = sim_config.type->product_id;
+	*interface_number = sim_config.type->interface_number;
+	return true;
+}
+
+/** Open the simulated device with the given path. */
+static void* tempered_type_hid_sim_open(
+	tempered_device *device, char const *path
+) {
+	long index = sim_parse_path( path );
+	if ( index < 0 )
+	{
+		tempered_set_error(
+			device, strdup( "No such simulated device." )
+		);
+		return NULL;
+	}
+	struct tempered_type_hid_sim_device *sim = malloc(
+		sizeof( struct tempered_type_hid_sim_device )
+	);
+	if ( sim == NULL )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_NO_MEMORY, "device", 0
+		);
+		return NULL;
+	}
+	sim->seed = sim_config.seed + index * 7919;
+	sim->queue_start = 0;
+	sim->queue_count = 0;
+#ifdef __linux__
+	sim->fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC );
+	if ( sim->fd < 0 )
+	{
+		tempered_set_error(
+			device, strdup( "Failed to create the simulated device timer." )
+		);
+		free( sim );
+		return NULL;
+	}
+#else
+	sim->fd = -1;
+#endif
+	return sim;
+}
+
+/** Close the given simulated device. */
+static void tempered_type_hid_sim_close( void *handle )
+{
+	struct tempered_type_hid_sim_device *sim =
+		(struct tempered_type_hid_sim_device *) handle;
+	if ( sim->fd >= 0 )
+	{
+		close( sim->fd );
+	}
+	free( sim );
+}
+
+/** Arm the device's timer for the first queued response, or disarm it if there
+ * are no queued responses.
+ */
+static void sim_update_timer( struct tempered_type_hid_sim_device *sim )
+{
+#ifdef __linux__
+	struct itimerspec timer = { .it_value = { 0, 0 } };
+	if ( sim->queue_count > 0 )
+	{
+		long long ready = sim->queue[sim->queue_start].ready;
+		timer.it_value.tv_sec = ready / 1000000000LL;
+		timer.it_value.tv_nsec = ready % 1000000000LL;
+	}
+	timerfd_settime( sim->fd, TFD_TIMER_ABSTIME, &timer, NULL );
+#else
+	(void) sim;
+#endif
+}
+
+/** Queue up a response on the given simulated device. */
+static void sim_queue_response(
+	struct tempered_type_hid_sim_device *sim, unsigned char const *data
+) {
+	if ( sim->queue_count >= SIM_QUEUE_LENGTH )
+	{
+		// The input queue is full, so the report is lost, like on a real device.
+		return;
+	}
+	int index = ( sim->queue_start + sim->queue_count ) % SIM_QUEUE_LENGTH;
+	double delay = sim_config.latency + sim_config.jitter * sim_random( sim );
+	long long ready = sim_now() + (long long)( delay * 1000000 );
+	if ( sim->queue_count > 0 )
+	{
+		// Reports arrive in order, so this can't overtake the previous one.
+		int previous = ( index + SIM_QUEUE_LENGTH - 1 ) % SIM_QUEUE_LENGTH;
+		if ( ready < sim->queue[previous].ready )
+		{
+			ready = sim->queue[previous].ready;
+		}
+	}
+	sim->queue[index].ready = ready;
+	memcpy( sim->queue[index].data, data, SIM_REPORT_LENGTH );
+	sim->queue_count++;
+	if ( sim->queue_count == 1 )
+	{
+		sim_update_timer( sim );
+	}
+}
+
+/** Queue up the responses to a subtype ID query. */
+static bool sim_respond_subtype(
+	struct tempered_type_hid_sim_device *sim,
+	unsigned char const *data, int length
+) {
+	struct temper_type *type = sim_config.type;
+	unsigned char response[SIM_REPORT_LENGTH];
+	if ( type->get_subtype_id == tempered_type_hid_get_subtype_id )
+	{
+		struct tempered_type_hid_subtype_data *subtype_data =
+			(struct tempered_type_hid_subtype_data*) type->get_subtype_data;
+		if (
+			subtype_data == NULL ||
+			subtype_data->query.length != length ||
+			memcmp( subtype_data->query.data, data, length ) != 0
+		) {
+			return false;
+		}
+		memset( response, 0, sizeof( response ) );
+		if ( length > 2 )
+		{
+			response[0] = ( data[1] == 0x01 ? data[2] : data[1] );
+		}
+		response[subtype_data->id_offset] = sim_config.subtype_id;
+		sim_queue_response( sim, response );
+		return true;
+	}
+	if ( type->get_subtype_id == tempered_type_hid_get_subtype_id_from_string )
+	{
+		struct tempered_type_hid_subtype_from_string_data *subtype_data =
+			(struct tempered_type_hid_subtype_from_string_data*)
+				type->get_subtype_data;
+		if (
+			subtype_data == NULL ||
+			subtype_data->query.length != length ||
+			memcmp( subtype_data->query.data, data, length ) != 0
+		) {
+			return false;
+		}
+		char const *string = "";
+		int i;
+		for ( i = 0; subtype_data->subtype_strings[i] != NULL ; i++ )
+		{
+			if ( i == sim_config.subtype_id )
+			{
+				string = subtype_data->subtype_strings[i];
+				break;
+			}
+		}
+		int string_length = strlen( string );
+		for ( i = 0; i < subtype_data->response_count ; i++ )
+		{
+			memset( response, 0, sizeof( response ) );
+			if ( i * SIM_REPORT_LENGTH < string_length )
+			{
+				int count = string_length - i * SIM_REPORT_LENGTH;
+				memcpy(
+					response, &string[i * SIM_REPORT_LENGTH],
+					count < SIM_REPORT_LENGTH ? count : SIM_REPORT_LENGTH
+				);
+			}
+			sim_queue_response( sim, response );
+		}
+		return true;
+	}
+	return false;
+}
+
+/** Queue up the response to a sensor group query, which is the configured data
+ * with the group's response header (if any) in front, like a real device.
+ */
+static bool sim_respond_sensors(
+	struct tempered_type_hid_sim_device *sim,
+	unsigned char const *data, int length
+) {
+	struct temper_subtype **subtypes = sim_config.type->subtypes;
+	int i, j;
+	for ( i = 0; subtypes[i] != NULL ; i++ )
+	{
+		if ( subtypes[i]->id != sim_config.subtype_id )
+		{
+			continue;
+		}
+		struct temper_subtype_hid *subtype =
+			(struct temper_subtype_hid *) subtypes[i];
+		for ( j = 0; j < subtype->sensor_group_count ; j++ )
+		{
+			struct tempered_type_hid_query *query =
+				&subtype->sensor_groups[j].query;
+			if (
+				query->length != length ||
+				memcmp( query->data, data, length ) != 0
+			) {
+				continue;
+			}
+			unsigned char response[SIM_REPORT_LENGTH];
+			memcpy( response, sim_config.data, SIM_REPORT_LENGTH );
+			if (
+				query->response_header_length > 0 &&
+				query->response_header_length <= SIM_REPORT_LENGTH
+			) {
+				memcpy(
+					response, query->response_header,
+					query->response_header_length
+				);
+			}
+			sim_queue_response( sim, response );
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Write a query to the given simulated device. */
+static int tempered_type_hid_sim_write(
+	tempered_device *device, void *handle,
+	unsigned char const *data, int length
+) {
+	struct tempered_type_hid_sim_device *sim =
+		(struct tempered_type_hid_sim_device *) handle;
+	if ( sim_random( sim ) < sim_config.fail_rate )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_WRITE, "simulated failure", 0
+		);
+		return -1;
+	}
+	if ( sim_random( sim ) < sim_config.drop_rate )
+	{
+		// The device silently ignores this query.
+		return length;
+	}
+	if (
+		!sim_respond_subtype( sim, data, length ) &&
+		!sim_respond_sensors( sim, data, length )
+	) {
+		sim_queue_response( sim, sim_config.data );
+	}
+	return length;
+}
+
+/** Read a response from the given simulated device. */
+static int tempered_type_hid_sim_read(
+	tempered_device *device, void *handle,
+	unsigned char *data, int length, int timeout
+) {
+	struct tempered_type_hid_sim_device *sim =
+		(struct tempered_type_hid_sim_device *) handle;
+	long long deadline = sim_now() + timeout * 1000000LL;
+	if ( sim_random( sim ) < sim_config.fail_rate )
+	{
+		tempered_set_error_code(
+			device, TEMPERED_ERROR_READ, "simulated failure", 0
+		);
+		return -1;
+	}
+	struct tempered_type_hid_sim_response *response =
+		&sim->queue[sim->queue_start];
+	if ( sim->queue_count == 0 || response->ready > deadline )
+	{
+		sim_sleep_until( deadline );
+		return 0;
+	}
+	sim_sleep_until( response->ready );
+	if ( length > SIM_REPORT_LENGTH )
+	{
+		length = SIM_REPORT_LENGTH;
+	}
+	memcpy( data, response->data, length );
+	sim->queue_start = ( sim->queue_start + 1 ) % SIM_QUEUE_LENGTH;
+	sim->queue_count--;
+	sim_update_timer( sim );
+	return length;
+}
+
+/** Get the timer that signals that the simulated device has a response. */
+static int tempered_type_hid_sim_get_fd( void *handle )
+{
+	return ( (struct tempered_type_hid_sim_device *) handle )->fd;
+}
+
+struct tempered_type_hid_transport const tempered_type_hid_transport_sim = {
+	.name = "sim",
+	.init = tempered_type_hid_sim_init,
+	.enumerate = tempered_type_hid_sim_enumerate,
+	.identify = tempered_type_hid_sim_identify,
+	.open = tempered_type_hid_sim_open,
+	.close = tempered_type_hid_sim_close,
+	.write = tempered_type_hid_sim_write,
+	.read = tempered_type_hid_sim_read,
+	.get_fd = tempered_type_hid_sim_get_fd
+};
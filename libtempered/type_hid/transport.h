@@ -0,0 +1,151 @@
+#ifndef TEMPERED__TYPE_HID__TRANSPORT_H
+#define TEMPERED__TYPE_HID__TRANSPORT_H
+
+/** This file holds the interface that the HID code uses to move bytes to and
+ * from the devices, so that the actual I/O method can be chosen at runtime.
+ */
+
+#include <stdbool.h>
+
+#include "../tempered.h"
+
+struct tempered_uring;
+struct tempered_device_list_builder;
+
+/** This struct represents a method of talking to HID devices. */
+struct tempered_type_hid_transport
+{
+	/** The name of this transport, as given to tempered_set_transport(). */
+	char const *name;
+	
+	/** Initialize the transport, or NULL if that is not necessary.
+	 * The options are the part of the transport name after the first colon,
+	 * or NULL if there was no such part.
+	 */
+	bool (*init)( char const *options, char **error );
+	
+	/** Finalize the transport, or NULL if that is not necessary. */
+	bool (*exit)( char **error );
+	
+	/** Enumerate the recognized devices that this transport can reach. */
+	struct tempered_device_list* (*enumerate)( char **error );
+	
+	/** Get the USB IDs and interface number of the device with the given
+	 * path without enumerating the other devices, or NULL if the transport
+	 * cannot do that (in which case the devices are enumerated instead).
+	 * @return Whether or not the device was identified.
+	 */
+	bool (*identify)(
+		char const *path, unsigned short *vendor_id,
+		unsigned short *product_id, int *interface_number, char **error
+	);
+	
+	/** Open the device with the given path, returning a transport-specific
+	 * handle for it, or NULL on error (in which case the device error is set).
+	 */
+	void* (*open)( tempered_device *device, char const *path );
+	
+	/** Close the given transport-specific handle. */
+	void (*close)( void *handle );
+	
+	/** Write an output report to the device.
+	 * The first byte of the data is the HID report ID.
+	 * @return The number of bytes written, or -1 on error (in which case the
+	 * device error is set).
+	 */
+	int (*write)(
+		tempered_device *device, void *handle,
+		unsigned char const *data, int length
+	);
+	
+	/** Read an input report from the device.
+	 * @param timeout How long to wait for a report, in milliseconds.
+	 * @return The number of bytes read, 0 on timeout, or -1 on error (in
+	 * which case the device error is set).
+	 */
+	int (*read)(
+		tempered_device *device, void *handle,
+		unsigned char *data, int length, int timeout
+	);
+	
+	/** Make sure that another input report will be read after the one that
+	 * was just read turned out not to be the response to its query, or NULL
+	 * if every read waits for the next report anyway. This is needed while
+	 * the device is attached to an io_uring, where each query has only one
+	 * read of its response queued along with it.
+	 * @return Whether or not another read is coming (if not, the device error
+	 * is set).
+	 */
+	bool (*read_again)( tempered_device *device, void *handle );
+	
+	/** Get a file descriptor that becomes readable when the device has an
+	 * input report ready, or NULL if the transport cannot provide one.
+	 * @return The file descriptor, or -1 if there is none.
+	 */
+	int (*get_fd)( void *handle );
+	
+	/** Get a string describing where the device is attached (e.g. its USB
+	 * port and serial number), which stays the same when it is plugged in
+	 * again at the same place, or NULL if the transport cannot tell.
+	 * @return Whether or not the location was stored.
+	 */
+	bool (*get_location)( void *handle, char *location, int size );
+	
+	/** Attach the device to the given io_uring, or detach it if that is NULL,
+	 * or NULL if the transport cannot use io_uring.
+	 * While the device is attached, writes are only queued on the ring (to be
+	 * submitted together with those of other devices), the response is read
+	 * by the ring as well, and reads never block.
+	 * @return Whether or not the device was attached.
+	 */
+	bool (*set_uring)( void *handle, struct tempered_uring *ring );
+};
+
+#ifdef TEMPERED_HAVE_HIDAPI
+/** The transport that uses the HIDAPI library. */
+extern struct tempered_type_hid_transport const
+	tempered_type_hid_transport_hidapi;
+#endif
+
+#ifdef TEMPERED_HAVE_HIDRAW
+/** The transport that uses the Linux hidraw device nodes directly. */
+extern struct tempered_type_hid_transport const
+	tempered_type_hid_transport_hidraw;
+
+/** Identify the hidraw device node with the given name (e.g. "hidraw0"),
+ * adding it to the device list that is being built if it is a TEMPer device
+ * that can be opened.
+ * @return false if there was no memory to add it, true otherwise.
+ */
+bool tempered_type_hid_hidraw_identify(
+	char const *name, struct tempered_device_list_builder *builder
+);
+#endif
+
+/** The transport that simulates devices in-process, for testing and profiling
+ * without any physical devices.
+ */
+extern struct tempered_type_hid_transport const
+	tempered_type_hid_transport_sim;
+
+/** The USB vendor ID of the device type that only exists in the simulation,
+ * which is reserved, so that no real device has it.
+ */
+#define TEMPERED_TYPE_HID_SIM_VENDOR_ID 0x0000
+
+/** The USB product ID of the device type that only exists in the simulation.
+ */
+#define TEMPERED_TYPE_HID_SIM_PRODUCT_ID 0x0001
+
+/** A device type that only exists in the simulation, whose subtype has several
+ * sensor groups that can be told apart by their response headers, so that
+ * simulated devices can be read with pipelined queries.
+ */
+extern struct temper_type tempered_type_hid_sim_type;
+
+/** Get the transport that is currently used for enumerating and opening. */
+struct tempered_type_hid_transport const * tempered_type_hid_get_transport(
+	void
+);
+
+#endif
@@ -17,18 +17,22 @@ struct tempered_type_hid_query
 	 * Note that the first byte of this should be the HID report ID.
 	 */
 	unsigned char *data;
-};
-
-/** This struct stores the data that was read back after a given query. */
-struct tempered_type_hid_query_result
-{
-	/** How many bytes of data was read from the device. */
-	int length;
 	
-	/** The data that was read from the device. */
-	unsigned char data[64];
+	/** How many bytes at the start of a response to this query must match
+	 * response_header for it to be accepted, or 0 to accept any response.
+	 */
+	int response_header_length;
+	
+	/** The bytes that a valid response to this query starts with.
+	 * Responses that don't are discarded as belonging to some other query.
+	 */
+	unsigned char *response_header;
 };
 
+/* The data that is read back after a given query is stored in the public
+ * struct tempered_report, so that it can live in a caller-supplied buffer.
+ */
+
 /** This struct stores the data used to get the subtype ID from the device. */
 struct tempered_type_hid_subtype_data
 {
@@ -62,7 +66,7 @@ struct tempered_type_hid_sensor
 	/** The method used to get the temperature from the sensor group's data. */
 	bool (*get_temperature)(
 		tempered_device*, struct tempered_type_hid_sensor*,
-		struct tempered_type_hid_query_result*, float*
+		struct tempered_report*, float*
 	);
 	
 	/** The method used to get the humidity from the sensor group's data.
@@ -70,7 +74,7 @@ struct tempered_type_hid_sensor
 	 */
 	bool (*get_humidity)(
 		tempered_device*, struct tempered_type_hid_sensor*,
-		struct tempered_type_hid_query_result*, float*
+		struct tempered_report*, float*
 	);
 	
 	/** The offset in the group data that holds the high byte of the
@@ -92,6 +96,11 @@ struct tempered_type_hid_sensor
 	 * humidity value.
 	 */
 	int humidity_low_byte_offset;
+	
+	/** The format of the raw codes of this sensor, which is one of the
+	 * TEMPERED_RAW_FORMAT_* constants.
+	 */
+	int raw_format;
 };
 
 /** This struct represents a group of sensors that are read simultaneously. */
@@ -103,7 +112,7 @@ struct tempered_type_hid_sensor_group
 	/** The method that is used to read the sensors for this sensor group. */
 	bool (*read_sensors)(
 		tempered_device*, struct tempered_type_hid_sensor_group*,
-		struct tempered_type_hid_query_result*
+		struct tempered_report*
 	);
 	
 	/** The number of sensors that are in this group. */
@@ -125,6 +134,16 @@ struct temper_subtype_hid
 	/** The array of sensor_group_count sensor groups that are in this subtype.
 	 */
 	struct tempered_type_hid_sensor_group *sensor_groups;
+	
+	/** Whether the device must answer one query before it is sent the next.
+	 * If this is false, the queries for all the sensor groups are written to
+	 * the device back-to-back, and the responses are matched to the groups in
+	 * the order they arrive, saving a round trip per additional group.
+	 * Groups that need more than a plain query, or whose responses don't each
+	 * have a response header of their own to check them by, are always read
+	 * one by one.
+	 */
+	bool serial_queries;
 };
 
 #endif
@@ -0,0 +1,343 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+#include "tempered-internal.h"
+
+/** This is the actual struct the tempered_uring type is built from. */
+struct tempered_uring
+{
+	/** The file descriptor of the io_uring instance. */
+	int fd;
+	
+	/** The mapping of the submission queue ring. */
+	void *sq_ring;
+	
+	/** The size of the submission queue ring mapping. */
+	size_t sq_ring_size;
+	
+	/** The mapping of the completion queue ring, which may be sq_ring. */
+	void *cq_ring;
+	
+	/** The size of the completion queue ring mapping. */
+	size_t cq_ring_size;
+	
+	/** The array of SQEs. */
+	struct io_uring_sqe *sqes;
+	
+	/** The size of the array of SQEs. */
+	size_t sqes_size;
+	
+	/** The number of entries in the submission queue. */
+	unsigned int sq_entries;
+	
+	/** Pointers to the submission queue ring's fields. */
+	unsigned int *sq_head, *sq_tail, *sq_mask, *sq_array;
+	
+	/** Pointers to the completion queue ring's fields. */
+	unsigned int *cq_head, *cq_tail, *cq_mask;
+	
+	/** The array of CQEs. */
+	struct io_uring_cqe *cqes;
+	
+	/** The number of SQEs that have been queued but not yet submitted. */
+	unsigned int queued;
+	
+	/** The number of submissions that have been made. */
+	unsigned int batch;
+	
+	/** The timeout for the reads that are queued, in milliseconds. */
+	int timeout;
+	
+	/** The head of the list of operations that are in flight. */
+	struct tempered_uring_op live;
+};
+
+/** Set the error to the given message followed by strerror(errnum). */
+static void uring_set_error( char **error, char const *message, int errnum )
+{
+	if ( error == NULL )
+	{
+		return;
+	}
+	char buffer[TEMPERED_STRERROR_SIZE];
+	char const *text = tempered_strerror_r( errnum, buffer, sizeof( buffer ) );
+	*error = tempered_format_string( "%s: %s", message, text );
+}
+
+/** Get the next SQE, cleared, with no operation (user_data 0) attached.
+ * The SQE must have been reserved with tempered_uring_reserve().
+ */
+static struct io_uring_sqe* uring_get_sqe( struct tempered_uring *ring )
+{
+	unsigned int tail = *ring->sq_tail;
+	unsigned int index = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset( sqe, 0, sizeof( struct io_uring_sqe ) );
+	ring->sq_array[index] = index;
+	// The kernel only looks at the SQEs when they are submitted, so it's fine
+	// that the caller fills this one in after it is made visible.
+	__atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+	ring->queued++;
+	return sqe;
+}
+
+/** Create an io_uring instance with room for the given number of SQEs. */
+struct tempered_uring* tempered_uring_create( unsigned int entries, char **error )
+{
+	struct tempered_uring *ring = calloc( 1, sizeof( struct tempered_uring ) );
+	if ( ring == NULL )
+	{
+		if ( error != NULL )
+		{
+			*error = strdup( "Could not allocate memory for the io_uring." );
+		}
+		return NULL;
+	}
+	ring->live.next = ring->live.prev = &ring->live;
+	ring->timeout = 1000;
+	ring->sq_ring = ring->cq_ring = MAP_FAILED;
+	ring->sqes = MAP_FAILED;
+	struct io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+	ring->fd = syscall( __NR_io_uring_setup, entries, &params );
+	if ( ring->fd < 0 )
+	{
+		uring_set_error( error, "Could not create the io_uring", errno );
+		free( ring );
+		return NULL;
+	}
+	ring->sq_ring_size =
+		params.sq_off.array + params.sq_entries * sizeof( unsigned int );
+	ring->cq_ring_size =
+		params.cq_off.cqes + params.cq_entries * sizeof( struct io_uring_cqe );
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		if ( ring->cq_ring_size > ring->sq_ring_size )
+		{
+			ring->sq_ring_size = ring->cq_ring_size;
+		}
+		ring->cq_ring_size = ring->sq_ring_size;
+	}
+	ring->sq_ring = mmap(
+		NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING
+	);
+	if ( ring->sq_ring != MAP_FAILED )
+	{
+		if ( params.features & IORING_FEAT_SINGLE_MMAP )
+		{
+			ring->cq_ring = ring->sq_ring;
+		}
+		else
+		{
+			ring->cq_ring = mmap(
+				NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING
+			);
+		}
+	}
+	if ( ring->cq_ring != MAP_FAILED )
+	{
+		ring->sqes_size = params.sq_entries * sizeof( struct io_uring_sqe );
+		ring->sqes = mmap(
+			NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES
+		);
+	}
+	if ( ring->sqes == MAP_FAILED )
+	{
+		uring_set_error( error, "Could not map the io_uring", errno );
+		tempered_uring_destroy( ring );
+		return NULL;
+	}
+	char *sq = (char *) ring->sq_ring, *cq = (char *) ring->cq_ring;
+	ring->sq_entries = params.sq_entries;
+	ring->sq_head = (unsigned int *)( sq + params.sq_off.head );
+	ring->sq_tail = (unsigned int *)( sq + params.sq_off.tail );
+	ring->sq_mask = (unsigned int *)( sq + params.sq_off.ring_mask );
+	ring->sq_array = (unsigned int *)( sq + params.sq_off.array );
+	ring->cq_head = (unsigned int *)( cq + params.cq_off.head );
+	ring->cq_tail = (unsigned int *)( cq + params.cq_off.tail );
+	ring->cq_mask = (unsigned int *)( cq + params.cq_off.ring_mask );
+	ring->cqes = (struct io_uring_cqe *)( cq + params.cq_off.cqes );
+	return ring;
+}
+
+/** Destroy an io_uring instance. */
+void tempered_uring_destroy( struct tempered_uring *ring )
+{
+	if ( ring == NULL )
+	{
+		return;
+	}
+	if ( ring->sqes != MAP_FAILED )
+	{
+		// Cancel the operations in flight, and wait until the kernel is done
+		// with their buffers before they are completed and freed.
+		struct tempered_uring_op *op;
+		for ( op = ring->live.next; op != &ring->live; op = op->next )
+		{
+			if ( !tempered_uring_reserve( ring, 1 ) )
+			{
+				break;
+			}
+			struct io_uring_sqe *sqe = uring_get_sqe( ring );
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = (unsigned long long)(uintptr_t) op;
+		}
+		tempered_uring_submit( ring );
+		while ( ring->live.next != &ring->live )
+		{
+			int result = syscall(
+				__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS,
+				NULL, 0
+			);
+			if ( result < 0 && errno != EINTR )
+			{
+				break;
+			}
+			tempered_uring_reap( ring );
+		}
+	}
+	if ( ring->sqes != MAP_FAILED )
+	{
+		munmap( ring->sqes, ring->sqes_size );
+	}
+	if ( ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring )
+	{
+		munmap( ring->cq_ring, ring->cq_ring_size );
+	}
+	if ( ring->sq_ring != MAP_FAILED )
+	{
+		munmap( ring->sq_ring, ring->sq_ring_size );
+	}
+	close( ring->fd );
+	while ( ring->live.next != &ring->live )
+	{
+		struct tempered_uring_op *op = ring->live.next;
+		op->next->prev = op->prev;
+		op->prev->next = op->next;
+		op->complete( op, -ECANCELED );
+	}
+	free( ring );
+}
+
+/** Get the file descriptor of the ring. */
+int tempered_uring_get_fd( struct tempered_uring *ring )
+{
+	return ring->fd;
+}
+
+/** Get the number of SQEs that fit in the ring. */
+unsigned int tempered_uring_get_entries( struct tempered_uring *ring )
+{
+	return ring->sq_entries;
+}
+
+/** Make sure the given number of SQEs can be queued without submitting. */
+bool tempered_uring_reserve( struct tempered_uring *ring, unsigned int count )
+{
+	if ( count > ring->sq_entries )
+	{
+		return false;
+	}
+	unsigned int head = __atomic_load_n( ring->sq_head, __ATOMIC_ACQUIRE );
+	if ( *ring->sq_tail - head + count <= ring->sq_entries )
+	{
+		return true;
+	}
+	return tempered_uring_submit( ring );
+}
+
+/** Queue an SQE for the given operation. */
+struct io_uring_sqe* tempered_uring_queue(
+	struct tempered_uring *ring, struct tempered_uring_op *op
+) {
+	struct io_uring_sqe *sqe = uring_get_sqe( ring );
+	sqe->user_data = (unsigned long long)(uintptr_t) op;
+	op->next = &ring->live;
+	op->prev = ring->live.prev;
+	op->prev->next = op;
+	ring->live.prev = op;
+	return sqe;
+}
+
+/** Submit all the queued SQEs to the kernel with a single system call. */
+bool tempered_uring_submit( struct tempered_uring *ring )
+{
+	if ( ring->queued == 0 )
+	{
+		return true;
+	}
+	while ( ring->queued > 0 )
+	{
+		int submitted = syscall(
+			__NR_io_uring_enter, ring->fd, ring->queued, 0, 0, NULL, 0
+		);
+		if ( submitted < 0 )
+		{
+			if ( errno == EINTR || errno == EAGAIN || errno == EBUSY )
+			{
+				// EBUSY means the completion queue is full, so empty it.
+				tempered_uring_reap( ring );
+				continue;
+			}
+			return false;
+		}
+		ring->queued -= submitted;
+	}
+	ring->batch++;
+	return true;
+}
+
+/** Get the number of times the ring has submitted SQEs to the kernel. */
+unsigned int tempered_uring_get_batch( struct tempered_uring *ring )
+{
+	return ring->batch;
+}
+
+/** Set the timeout for the reads that are queued from now on. */
+void tempered_uring_set_timeout( struct tempered_uring *ring, int timeout )
+{
+	ring->timeout = timeout;
+}
+
+/** Get the timeout for the reads that are queued. */
+int tempered_uring_get_timeout( struct tempered_uring *ring )
+{
+	return ring->timeout;
+}
+
+/** Call the complete function of every operation that has completed. */
+int tempered_uring_reap( struct tempered_uring *ring )
+{
+	int count = 0;
+	unsigned int head = *ring->cq_head;
+	while ( head != __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) )
+	{
+		struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+		struct tempered_uring_op *op =
+			(struct tempered_uring_op *)(uintptr_t) cqe->user_data;
+		int result = cqe->res;
+		head++;
+		__atomic_store_n( ring->cq_head, head, __ATOMIC_RELEASE );
+		if ( op == NULL )
+		{
+			// This was not an operation of ours, but e.g. a cancellation.
+			continue;
+		}
+		op->next->prev = op->prev;
+		op->prev->next = op->next;
+		op->complete( op, result );
+		count++;
+	}
+	return count;
+}
@@ -0,0 +1,89 @@
+#ifndef TEMPERED__URING_H
+#define TEMPERED__URING_H
+
+/** This file holds a minimal io_uring wrapper, used to batch the reads and
+ * writes of many devices into a single system call.
+ *
+ * It talks to the kernel directly instead of using liburing, so it has no
+ * dependencies beyond the kernel headers.
+ */
+
+#include <stdbool.h>
+#include <linux/io_uring.h>
+
+/** This struct represents an operation that has been queued on a ring.
+ * It is usually embedded in a larger struct holding the operation's buffers.
+ */
+struct tempered_uring_op
+{
+	/** The function that is called when the operation has completed.
+	 * @param op The operation that completed.
+	 * @param result The result of the operation, as in io_uring_cqe.res.
+	 */
+	void (*complete)( struct tempered_uring_op *op, int result );
+	
+	/** The previous operation in the ring's list of operations in flight. */
+	struct tempered_uring_op *prev;
+	
+	/** The next operation in the ring's list of operations in flight. */
+	struct tempered_uring_op *next;
+};
+
+/** This type represents an io_uring instance. */
+struct tempered_uring;
+
+/** Create an io_uring instance with room for the given number of SQEs.
+ * @return The new ring, or NULL on error (with the error set if not NULL).
+ */
+struct tempered_uring* tempered_uring_create( unsigned int entries, char **error );
+
+/** Destroy an io_uring instance.
+ * The operations that are still in flight are completed with -ECANCELED.
+ */
+void tempered_uring_destroy( struct tempered_uring *ring );
+
+/** Get the file descriptor of the ring, which is readable when there are
+ * completed operations for tempered_uring_reap() to process.
+ */
+int tempered_uring_get_fd( struct tempered_uring *ring );
+
+/** Get the number of SQEs that fit in the ring. */
+unsigned int tempered_uring_get_entries( struct tempered_uring *ring );
+
+/** Make sure the given number of SQEs can be queued without submitting.
+ * This submits the already queued SQEs if necessary, so that a chain of linked
+ * SQEs is never split across two submissions.
+ */
+bool tempered_uring_reserve( struct tempered_uring *ring, unsigned int count );
+
+/** Queue an SQE for the given operation.
+ * @return The cleared SQE, which the caller fills in (except user_data).
+ * The SQE must have been reserved with tempered_uring_reserve().
+ */
+struct io_uring_sqe* tempered_uring_queue(
+	struct tempered_uring *ring, struct tempered_uring_op *op
+);
+
+/** Submit all the queued SQEs to the kernel with a single system call. */
+bool tempered_uring_submit( struct tempered_uring *ring );
+
+/** Get the number of times the ring has submitted SQEs to the kernel.
+ * This can be used to tell whether an operation was queued before or after
+ * the last submission.
+ */
+unsigned int tempered_uring_get_batch( struct tempered_uring *ring );
+
+/** Set the timeout for the reads that are queued from now on, in ms.
+ * The reads are cancelled if they have not completed by then.
+ */
+void tempered_uring_set_timeout( struct tempered_uring *ring, int timeout );
+
+/** Get the timeout for the reads that are queued, in milliseconds. */
+int tempered_uring_get_timeout( struct tempered_uring *ring );
+
+/** Call the complete function of every operation that has completed.
+ * @return The number of operations that were completed.
+ */
+int tempered_uring_reap( struct tempered_uring *ring );
+
+#endif
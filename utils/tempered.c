@@ -233,9 +233,37 @@ void print_device_sensor(
 	}
 }
 
-/** Print the sensor values for a given device. */
-void print_device(
-	struct tempered_device_list *dev, struct my_options *options
+/** Print the sensor values for a given device that has been read. */
+void print_device( tempered_device *device, struct my_options *options )
+{
+	int sensor, sensors = tempered_get_sensor_count( device );
+	for ( sensor = 0; sensor < sensors; sensor++ )
+	{
+		print_device_sensor( device, sensor, options );
+	}
+}
+
+/** Add an opened device to the set of devices to be read.
+ * The device is closed if it could not be added.
+ */
+tempered_device* add_device( tempered_device *device, tempered_device_set *set )
+{
+	if ( !tempered_device_set_add( set, device ) )
+	{
+		fprintf(
+			stderr, "%s: Could not add device to the set: %s\n",
+			tempered_get_device_path( device ), tempered_error( device )
+		);
+		tempered_close( device );
+		return NULL;
+	}
+	return device;
+}
+
+/** Open the given device and add it to the set of devices to be read. */
+tempered_device* open_device(
+	struct tempered_device_list *dev, struct my_options *options,
+	tempered_device_set *set
 ) {
 	if ( options->enumerate )
 	{
@@ -243,7 +271,7 @@ void print_device(
 			"%s : %s (USB IDs %04X:%04X)\n",
 			dev->path, dev->type_name, dev->vendor_id, dev->product_id
 		);
-		return;
+		return NULL;
 	}
 	char *error = NULL;
 	tempered_device *device = tempered_open( dev, &error );
@@ -254,51 +282,137 @@ void print_device(
 			dev->path, error
 		);
 		free( error );
-		return;
+		return NULL;
 	}
-	if ( !tempered_read_sensors( device ) )
+	return add_device( device, set );
+}
+
+/** Open the device with the given path without enumerating the devices, and
+ * add it to the set of devices to be read.
+ */
+tempered_device* open_device_path( char const *path, tempered_device_set *set )
+{
+	char *error = NULL;
+	tempered_device *device = tempered_open_path( path, &error );
+	if ( device == NULL )
 	{
-		fprintf(
-			stderr, "%s: Failed to read the sensors: %s\n",
-			tempered_get_device_path( device ),
-			tempered_error( device )
-		);
+		fprintf( stderr, "%s: Could not open device: %s\n", path, error );
+		free( error );
+		return NULL;
 	}
-	else
+	return add_device( device, set );
+}
+
+/** Read all the opened devices at once, and print their sensor values.
+ * @return Whether or not all the devices were read.
+ */
+bool read_devices(
+	tempered_device **devices, int count, struct my_options *options,
+	tempered_device_set *set
+) {
+	int i;
+	bool success = true;
+	if ( count == 0 )
+	{
+		return success;
+	}
+	tempered_device_set_read_all( set, -1 );
+	for ( i = 0; i < count; i++ )
 	{
-		int sensor, sensors = tempered_get_sensor_count( device );
-		for ( sensor = 0; sensor < sensors; sensor++ )
+		if ( !tempered_device_set_read_ok( set, devices[i] ) )
 		{
-			print_device_sensor( device, sensor, options );
+			success = false;
+			fprintf(
+				stderr, "%s: Failed to read the sensors: %s\n",
+				tempered_get_device_path( devices[i] ),
+				tempered_error( devices[i] )
+			);
 		}
+		else
+		{
+			print_device( devices[i], options );
+		}
+		tempered_device_set_remove( set, devices[i] );
+		tempered_close( devices[i] );
 	}
-	tempered_close( device );
+	return success;
 }
 
-int main( int argc, char *argv[] )
+/** Open and read the devices that were given by path, without enumerating.
+ * @return Whether or not all the devices were opened and read.
+ */
+bool read_device_paths( struct my_options *options, tempered_device_set *set )
 {
-	struct my_options *options = parse_options( argc, argv );
-	if ( options == NULL )
+	bool success = true;
+	int count = 0;
+	while ( options->devices[count] != NULL )
 	{
-		return 1;
+		count++;
 	}
-	char *error = NULL;
-	if ( !tempered_init( &error ) )
+	tempered_device **devices = calloc( count, sizeof( tempered_device* ) );
+	int i;
+	count = 0;
+	for ( i = 0; options->devices[i] != NULL ; i++ )
 	{
-		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
-		free( error );
-		free_options( options );
-		return 1;
+		devices[count] = open_device_path( options->devices[i], set );
+		if ( devices[count] != NULL )
+		{
+			count++;
+		}
+		else
+		{
+			success = false;
+		}
 	}
-	
+	if ( !read_devices( devices, count, options, set ) )
+	{
+		success = false;
+	}
+	free( devices );
+	return success;
+}
+
+/** Enumerate the devices, and open and read (or just list) either the ones
+ * that were given or all of them.
+ * @return Whether or not all of those devices were found, opened and read.
+ */
+bool enumerate_devices( struct my_options *options, tempered_device_set *set )
+{
+	char *error = NULL;
+	bool success = true;
 	struct tempered_device_list *list = tempered_enumerate( &error );
 	if ( list == NULL )
 	{
-		fprintf( stderr, "Failed to enumerate devices: %s\n", error );
-		free( error );
+		if ( error == NULL )
+		{
+			printf( "No devices were found.\n" );
+			// That's only a failure if some devices were asked for.
+			success = ( options->devices == NULL );
+		}
+		else
+		{
+			fprintf( stderr, "Failed to enumerate devices: %s\n", error );
+			free( error );
+			success = false;
+		}
 	}
 	else
 	{
+		int count = 0;
+		struct tempered_device_list *dev;
+		for ( dev = list ; dev != NULL ; dev = dev->next )
+		{
+			count++;
+		}
+		int given = 0;
+		while ( options->devices != NULL && options->devices[given] != NULL )
+		{
+			// The same device may be given more than once.
+			given++;
+		}
+		count += given;
+		tempered_device **devices = calloc( count, sizeof( tempered_device* ) );
+		count = 0;
 		if ( options->devices != NULL )
 		{
 			// We have parameters, so only print those devices that are given.
@@ -306,18 +420,26 @@ int main( int argc, char *argv[] )
 			for ( i = 0; options->devices[i] != NULL ; i++ )
 			{
 				bool found = false;
-				struct tempered_device_list *dev;
 				for ( dev = list ; dev != NULL ; dev = dev->next )
 				{
 					if ( strcmp( dev->path, options->devices[i] ) == 0 )
 					{
 						found = true;
-						print_device( dev, options );
+						devices[count] = open_device( dev, options, set );
+						if ( devices[count] != NULL )
+						{
+							count++;
+						}
+						else
+						{
+							success = false;
+						}
 						break;
 					}
 				}
 				if ( !found )
 				{
+					success = false;
 					fprintf(
 						stderr, "%s: TEMPered device not found or ignored.\n",
 						options->devices[i]
@@ -328,14 +450,66 @@ int main( int argc, char *argv[] )
 		else
 		{
 			// We don't have any parameters, so print all the devices we found.
-			struct tempered_device_list *dev;
 			for ( dev = list ; dev != NULL ; dev = dev->next )
 			{
-				print_device( dev, options );
+				devices[count] = open_device( dev, options, set );
+				if ( devices[count] != NULL )
+				{
+					count++;
+				}
+				else
+				{
+					success = false;
+				}
 			}
 		}
 		tempered_free_device_list( list );
+		if ( !read_devices( devices, count, options, set ) )
+		{
+			success = false;
+		}
+		free( devices );
+	}
+	return success;
+}
+
+int main( int argc, char *argv[] )
+{
+	struct my_options *options = parse_options( argc, argv );
+	if ( options == NULL )
+	{
+		return 1;
+	}
+	char *error = NULL;
+	if ( !tempered_init( &error ) )
+	{
+		fprintf( stderr, "Failed to initialize libtempered: %s\n", error );
+		free( error );
+		free_options( options );
+		return 1;
+	}
+	
+	tempered_device_set *set = tempered_device_set_create( &error );
+	if ( set == NULL )
+	{
+		fprintf( stderr, "Failed to create the device set: %s\n", error );
+		free( error );
+		tempered_exit( NULL );
+		free_options( options );
+		return 1;
+	}
+	
+	bool success;
+	if ( options->devices != NULL && !options->enumerate )
+	{
+		// We know which devices to read, so there's no need to enumerate.
+		success = read_device_paths( options, set );
+	}
+	else
+	{
+		success = enumerate_devices( options, set );
 	}
+	tempered_device_set_destroy( set );
 	
 	if ( !tempered_exit( &error ) )
 	{
@@ -344,5 +518,5 @@ int main( int argc, char *argv[] )
 		free_options( options );
 		return 1;
 	}
-	return 0;
+	return success ? 0 : 1;
 }